@@ -0,0 +1,79 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ast.h"
+
+AstArena* ast = NULL;
+
+void initAst(void) {
+  ast = (AstArena*) malloc(sizeof(AstArena));
+  ast->nodes = (AstNode*) malloc(INITIAL_AST_SIZE * sizeof(AstNode));
+  ast->nodeCount = 0;
+  ast->maxNodeCount = INITIAL_AST_SIZE;
+}
+
+void cleanAst(void) {
+  free(ast->nodes);
+  free(ast);
+  ast = NULL;
+}
+
+// The array doubles when full, so a node is only known by its index 
+// while the tree grows
+AstIndex createAstNode(enum AstKind kind) {
+  AstNode* node;
+
+  if (ast->nodeCount == ast->maxNodeCount) {
+    ast->maxNodeCount *= 2;
+    ast->nodes = (AstNode*) realloc(ast->nodes, ast->maxNodeCount * sizeof(AstNode));
+    if (ast->nodes == NULL) {
+      printf("Out of memory for the syntax tree!\n");
+      exit(-1);
+    }
+  }
+
+  node = ast->nodes + ast->nodeCount;
+  node->kind = kind;
+  node->op = TK_NONE;
+  node->value = 0;
+  node->object = NULL;
+  node->type = NULL;
+  node->child = AST_NONE;
+  node->lastChild = AST_NONE;
+  node->sibling = AST_NONE;
+  return ast->nodeCount ++;
+}
+
+AstIndex createObjectNode(enum AstKind kind, Object* obj) {
+  AstIndex node = createAstNode(kind);
+
+  getAstNode(node)->object = obj;
+  return node;
+}
+
+// The nodes from first on are dropped, their indexes are reused
+void dropAstNodes(AstIndex first) {
+  ast->nodeCount = first;
+}
+
+AstNode* getAstNode(AstIndex index) {
+  return ast->nodes + index;
+}
+
+void addAstChild(AstIndex parent, AstIndex child) {
+  AstNode* node = getAstNode(parent);
+
+  if (node->child == AST_NONE)
+    node->child = child;
+  else getAstNode(node->lastChild)->sibling = child;
+  node->lastChild = child;
+}
+
+int countAstNodes(void) {
+  return ast->nodeCount;
+}
@@ -0,0 +1,79 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __AST_H__
+#define __AST_H__
+
+#include "token.h"
+#include "symtab.h"
+
+#define AST_NONE -1
+#define INITIAL_AST_SIZE 1024
+
+enum AstKind {
+  AST_PROGRAM,       // object: program, child: block
+  AST_FUNCTION,      // object: function, child: block
+  AST_PROCEDURE,     // object: procedure, child: block
+  AST_BLOCK,         // object: owner, children: subprograms, then the body group
+
+  AST_EMPTY,
+  AST_ASSIGN,        // children: lvalue, expression
+  AST_CALL,          // object: procedure, children: arguments
+  AST_GROUP,         // children: statements
+  AST_IF,            // children: condition, statement, else statement
+  AST_WHILE,         // children: condition, statement
+  AST_FOR,           // children: lvalue, from, to, statement
+
+  AST_CONDITION,     // op: comparison, children: two expressions
+  AST_EXPRESSION,    // children: first operand, then operations
+  AST_OPERATION,     // op: + - * /, child: operand applied to the result so far
+  AST_NEGATE,        // child: expression
+  AST_CONSTANT,      // value
+  AST_VARIABLE,      // object: variable of a basic type
+  AST_ELEMENT,       // object: array variable, children: indexes
+  AST_INDEX,         // type: indexed array, child: expression
+  AST_PARAMETER,     // object: parameter
+  AST_RETURN_VALUE,  // object: function
+  AST_FUNCTION_CALL  // object: function, children: arguments
+};
+
+// Nodes are kept in one array, and refer to each other by index
+typedef int AstIndex;
+
+struct AstNode_ {
+  enum AstKind kind;
+  TokenType op;
+  int value;
+  Object* object;
+  Type* type;
+  AstIndex child;      // first child
+  AstIndex lastChild;
+  AstIndex sibling;    // next child of the parent
+};
+
+typedef struct AstNode_ AstNode;
+
+struct AstArena_ {
+  AstNode* nodes;
+  int nodeCount;
+  int maxNodeCount;
+};
+
+typedef struct AstArena_ AstArena;
+
+extern AstArena* ast;
+
+void initAst(void);
+void cleanAst(void);
+
+AstIndex createAstNode(enum AstKind kind);
+AstIndex createObjectNode(enum AstKind kind, Object* obj);
+void dropAstNodes(AstIndex first);
+AstNode* getAstNode(AstIndex index);
+void addAstChild(AstIndex parent, AstIndex child);
+int countAstNodes(void);
+
+#endif
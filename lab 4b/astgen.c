@@ -0,0 +1,453 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include "astgen.h"
+#include "codegen.h"
+#include "optimizer.h"
+#include "stats.h"
+
+// The code of the syntax tree. parser.c generates each body as soon as
+// it is parsed, -ast the whole program once it is parsed.
+
+extern __thread SymTab* symtab;
+extern int boundsCheck;
+extern int optimizationLevel;
+
+// Generate each subprogram without the code of the nested ones, which
+// is generated apart and linked later. The calls are left to the linker.
+int separateSubprograms = 0;
+
+void genProgramNode(AstIndex node) {
+  AstNode* program = getAstNode(node);
+  Object* obj = program->object;
+
+  obj->progAttrs->codeAddress = getCurrentCodeAddress();
+  enterBlock(obj->progAttrs->scope);
+
+  genBlockNode(program->child);
+
+  // Halt the program
+  genHL();
+
+  exitBlock();
+}
+
+void genBlockNode(AstIndex node) {
+  CodeAddress jmp;
+  CodeAddress bodyAddress;
+  AstIndex child;
+  AstIndex body = AST_NONE;
+
+  // Jump to the body of the block
+  jmp = genJ(DC_VALUE);
+
+  for (child = getAstNode(node)->child; child != AST_NONE; child = getAstNode(child)->sibling)
+    switch (getAstNode(child)->kind) {
+    case AST_FUNCTION:
+      if (!separateSubprograms)
+	genFunctionNode(child);
+      break;
+    case AST_PROCEDURE:
+      if (!separateSubprograms)
+	genProcedureNode(child);
+      break;
+    default:
+      body = child;
+      break;
+    }
+
+  // Update the jmp label
+  bodyAddress = getCurrentCodeAddress();
+  updateJ(jmp, bodyAddress);
+  // Skip the stack frame
+  genINT(symtab->currentScope->frameSize);
+
+  genStatementNode(body);
+
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    removeDeadVariables(symtab->currentScope, bodyAddress);
+    leavePhase();
+  }
+}
+
+void genFunctionNode(AstIndex node) {
+  AstNode* function = getAstNode(node);
+  Object* funcObj = function->object;
+
+  if (!separateSubprograms)
+    funcObj->funcAttrs->codeAddress = getCurrentCodeAddress();
+  enterBlock(funcObj->funcAttrs->scope);
+
+  genBlockNode(function->child);
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    eliminateTailCalls(funcObj->funcAttrs->codeAddress);
+    leavePhase();
+  }
+  genEF();
+
+  exitBlock();
+}
+
+void genProcedureNode(AstIndex node) {
+  AstNode* procedure = getAstNode(node);
+  Object* procObj = procedure->object;
+
+  if (!separateSubprograms)
+    procObj->procAttrs->codeAddress = getCurrentCodeAddress();
+  enterBlock(procObj->procAttrs->scope);
+
+  genBlockNode(procedure->child);
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    eliminateTailCalls(procObj->procAttrs->codeAddress);
+    leavePhase();
+  }
+  genEP();
+
+  exitBlock();
+}
+
+void genStatementNode(AstIndex node) {
+  AstIndex child;
+
+  switch (getAstNode(node)->kind) {
+  case AST_ASSIGN:
+    genAssignNode(node);
+    break;
+  case AST_CALL:
+    genCallNode(node);
+    break;
+  case AST_GROUP:
+    for (child = getAstNode(node)->child; child != AST_NONE; child = getAstNode(child)->sibling)
+      genStatementNode(child);
+    break;
+  case AST_IF:
+    genIfNode(node);
+    break;
+  case AST_WHILE:
+    genWhileNode(node);
+    break;
+  case AST_FOR:
+    genForNode(node);
+    break;
+  default:
+    break;
+  }
+}
+
+void genAssignNode(AstIndex node) {
+  AstIndex lvalue = getAstNode(node)->child;
+
+  genLValueNode(lvalue);
+  genExpressionNode(getAstNode(lvalue)->sibling);
+  genST();
+}
+
+void genCallNode(AstIndex node) {
+  AstNode* call = getAstNode(node);
+  Object* proc = call->object;
+  CodeAddress callAddress;
+
+  if (isPredefinedProcedure(proc)) {
+    genArgumentNodes(proc->procAttrs->paramList, call->child);
+    genPredefinedProcedureCall(proc);
+  } else {
+    callAddress = getCurrentCodeAddress();
+    // The frame starts on the current top, which is left untouched
+    genINT(PROCEDURE_RESERVED_WORDS);
+    genArgumentNodes(proc->procAttrs->paramList, call->child);
+    if ((optimizationLevel < 2) || !genInlinedCall(proc, callAddress)) {
+      genDCT(RESERVED_WORDS + proc->procAttrs->paramCount);
+      genProcedureCall(proc);
+    }
+  }
+}
+
+void genIfNode(AstIndex node) {
+  AstIndex condition = getAstNode(node)->child;
+  AstIndex thenSt = getAstNode(condition)->sibling;
+  AstIndex elseSt = getAstNode(thenSt)->sibling;
+  CodeAddress fjAddress;
+  CodeAddress jAddress;
+
+  genConditionNode(condition);
+
+  if (optimizationLevel >= 1)
+    fjAddress = genFalseJump(DC_VALUE);
+  else fjAddress = genFJ(DC_VALUE);
+  genStatementNode(thenSt);
+  if (elseSt != AST_NONE) {
+    jAddress = genJ(DC_VALUE);
+    updateFJ(fjAddress, getCurrentCodeAddress());
+    genStatementNode(elseSt);
+    updateJ(jAddress, getCurrentCodeAddress());
+  } else {
+    updateFJ(fjAddress, getCurrentCodeAddress());
+  }
+}
+
+void genWhileNode(AstIndex node) {
+  AstIndex condition = getAstNode(node)->child;
+  CodeAddress beginWhile;
+  CodeAddress operand2;
+  CodeAddress comparison;
+  CodeAddress fjAddress;
+  int growth;
+  int temps = 0;
+
+  beginWhile = getCurrentCodeAddress();
+  operand2 = genConditionNode(condition);
+  comparison = getCurrentCodeAddress() - 1;
+  if (optimizationLevel >= 1)
+    fjAddress = genFalseJump(DC_VALUE);
+  else fjAddress = genFJ(DC_VALUE);
+  genStatementNode(getAstNode(condition)->sibling);
+  genJ(beginWhile);
+  updateFJ(fjAddress, getCurrentCodeAddress());
+
+  // Evaluate the invariant operands once, the second one moves with the first
+  if (optimizationLevel >= 1) {
+    growth = genHoistedInvariant(beginWhile, beginWhile, operand2);
+    if (growth > 0) temps ++;
+    if (genHoistedInvariant(beginWhile, operand2 + growth, comparison + growth) > 0) temps ++;
+  }
+  if (temps > 0)
+    genDCT(temps);
+}
+
+void genForNode(AstIndex node) {
+  AstIndex lvalue = getAstNode(node)->child;
+  AstIndex from = getAstNode(lvalue)->sibling;
+  AstIndex to = getAstNode(from)->sibling;
+  CodeAddress beginLoop;
+  CodeAddress beginBody;
+  CodeAddress varCode;
+  CodeAddress fromCode;
+  CodeAddress exprCode;
+  CodeAddress exprEnd;
+  CodeAddress fjAddress;
+  WORD low, high;
+  int constantRange;
+
+  varCode = getCurrentCodeAddress();
+  genLValueNode(lvalue);
+
+  genCV();
+  fromCode = getCurrentCodeAddress();
+  genExpressionNode(from);
+  constantRange = isConstantCode(fromCode, &low);
+  genST();
+  genCV();
+  genLI();
+  beginLoop = getCurrentCodeAddress();
+
+  exprCode = getCurrentCodeAddress();
+  genExpressionNode(to);
+  constantRange = constantRange && isConstantCode(exprCode, &high);
+  exprEnd = getCurrentCodeAddress();
+  genLE();
+  if (optimizationLevel >= 1)
+    fjAddress = genFalseJump(DC_VALUE);
+  else fjAddress = genFJ(DC_VALUE);
+
+  beginBody = getCurrentCodeAddress();
+  genStatementNode(getAstNode(to)->sibling);
+
+  // With constant bounds the loop variable stays in [low, high] inside the body
+  if (boundsCheck && constantRange) {
+    enterPhase(PHASE_OPTIMIZER);
+    removeSafeBoundsChecks(getInstruction(varCode), low, high, beginBody);
+    leavePhase();
+  }
+
+  genCV();
+  genCV();
+  genLI();
+  genLC(1);
+  genAD();
+  genST();
+
+  genCV();
+  genLI();
+
+  genJ(beginLoop);
+  updateFJ(fjAddress, getCurrentCodeAddress());
+
+  // Step the variable in a single instruction if the bound is invariant
+  if ((optimizationLevel >= 1) && genFusedForLoop(varCode, fromCode, exprCode, exprEnd))
+    genDCT(2);
+  else genDCT(1);
+}
+
+// The arguments from argument on, for the parameters of paramList
+void genArgumentNodes(ObjectNode* paramList, AstIndex argument) {
+  ObjectNode* param;
+
+  for (param = paramList; param != NULL; param = param->next) {
+    if (param->object->paramAttrs->kind == PARAM_VALUE)
+      genExpressionNode(argument);
+    else genLValueNode(argument);
+    argument = getAstNode(argument)->sibling;
+  }
+}
+
+// Returns the address of the code of the second operand
+CodeAddress genConditionNode(AstIndex node) {
+  AstNode* condition = getAstNode(node);
+  CodeAddress operand2;
+
+  genExpressionNode(condition->child);
+  operand2 = getCurrentCodeAddress();
+  genExpressionNode(getAstNode(condition->child)->sibling);
+
+  switch (condition->op) {
+  case SB_EQ:
+    genEQ();
+    break;
+  case SB_NEQ:
+    genNE();
+    break;
+  case SB_LE:
+    genLE();
+    break;
+  case SB_LT:
+    genLT();
+    break;
+  case SB_GE:
+    genGE();
+    break;
+  case SB_GT:
+    genGT();
+    break;
+  default:
+    break;
+  }
+
+  return operand2;
+}
+
+void genLValueNode(AstIndex node) {
+  AstNode* lvalue = getAstNode(node);
+  Object* var = lvalue->object;
+
+  switch (lvalue->kind) {
+  case AST_VARIABLE:
+    genVariableAddress(var);
+    break;
+  case AST_ELEMENT:
+    genVariableAddress(var);
+    genIndexNodes(lvalue->child);
+    break;
+  case AST_PARAMETER:
+    if (var->paramAttrs->kind == PARAM_VALUE)
+      genParameterAddress(var);
+    else genParameterValue(var);
+    break;
+  case AST_RETURN_VALUE:
+    genReturnValueAddress(var);
+    break;
+  default:
+    break;
+  }
+}
+
+// A chain of operations is generated in a loop, like it is parsed
+void genExpressionNode(AstIndex node) {
+  AstNode* expression = getAstNode(node);
+  AstIndex operation;
+
+  switch (expression->kind) {
+  case AST_EXPRESSION:
+    genExpressionNode(expression->child);
+    for (operation = getAstNode(expression->child)->sibling; operation != AST_NONE;
+	 operation = getAstNode(operation)->sibling) {
+      genExpressionNode(getAstNode(operation)->child);
+      switch (getAstNode(operation)->op) {
+      case SB_PLUS:
+	genAD();
+	break;
+      case SB_MINUS:
+	genSB();
+	break;
+      case SB_TIMES:
+	genML();
+	break;
+      case SB_SLASH:
+	genDV();
+	break;
+      default:
+	break;
+      }
+    }
+    break;
+  case AST_NEGATE:
+    genExpressionNode(expression->child);
+    genNEG();
+    break;
+  case AST_CONSTANT:
+    genLC(expression->value);
+    break;
+  case AST_VARIABLE:
+    genVariableValue(expression->object);
+    break;
+  case AST_ELEMENT:
+    genVariableAddress(expression->object);
+    genIndexNodes(expression->child);
+    genLI();
+    break;
+  case AST_PARAMETER:
+    genParameterValue(expression->object);
+    if (expression->object->paramAttrs->kind == PARAM_REFERENCE)
+      genLI();
+    break;
+  case AST_FUNCTION_CALL:
+    genFunctionCallNode(node);
+    break;
+  default:
+    break;
+  }
+}
+
+void genFunctionCallNode(AstIndex node) {
+  AstNode* call = getAstNode(node);
+  Object* obj = call->object;
+  CodeAddress callAddress;
+
+  if (isPredefinedFunction(obj)) {
+    genArgumentNodes(obj->funcAttrs->paramList, call->child);
+    genPredefinedFunctionCall(obj);
+  } else {
+    callAddress = getCurrentCodeAddress();
+    genINT(RESERVED_WORDS);
+    genArgumentNodes(obj->funcAttrs->paramList, call->child);
+    if ((optimizationLevel < 2) || !genInlinedCall(obj, callAddress)) {
+      genDCT(RESERVED_WORDS + obj->funcAttrs->paramCount);
+      genFunctionCall(obj);
+    }
+  }
+}
+
+// The indexes from index on move the address of the array to the element
+void genIndexNodes(AstIndex index) {
+  AstNode* node;
+  Type* arrayType;
+
+  for (; index != AST_NONE; index = node->sibling) {
+    node = getAstNode(index);
+    arrayType = node->type;
+
+    genExpressionNode(node->child);
+    if (boundsCheck)
+      genBC(arrayType->arraySize);
+    // Move the address to the indexed element
+    genLC(sizeOfType(arrayType->elementType));
+    genML();
+    genAD();
+  }
+}
@@ -0,0 +1,34 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ASTGEN_H__
+#define __ASTGEN_H__
+
+#include "ast.h"
+#include "instructions.h"
+
+extern int separateSubprograms;
+
+void genProgramNode(AstIndex node);
+void genBlockNode(AstIndex node);
+void genFunctionNode(AstIndex node);
+void genProcedureNode(AstIndex node);
+
+void genStatementNode(AstIndex node);
+void genAssignNode(AstIndex node);
+void genCallNode(AstIndex node);
+void genIfNode(AstIndex node);
+void genWhileNode(AstIndex node);
+void genForNode(AstIndex node);
+
+void genArgumentNodes(ObjectNode* paramList, AstIndex argument);
+CodeAddress genConditionNode(AstIndex node);
+void genLValueNode(AstIndex node);
+void genExpressionNode(AstIndex node);
+void genFunctionCallNode(AstIndex node);
+void genIndexNodes(AstIndex index);
+
+#endif
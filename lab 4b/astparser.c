@@ -0,0 +1,171 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reader.h"
+#include "scanner.h"
+#include "parser.h"
+#include "semantics.h"
+#include "error.h"
+#include "astparser.h"
+#include "astgen.h"
+#include "pargen.h"
+#include "stats.h"
+
+// The blocks of the whole program kept in a syntax tree instead of being
+// generated one by one. The statements are parsed by parser.c, and the
+// declarations emit nothing and are shared.
+
+extern Token *currentToken;
+extern Token *lookAhead;
+
+extern int optimizationLevel;
+extern int codeThreads;
+extern char* sourceFileName;
+
+AstIndex buildProgram(void) {
+  Object* program;
+  AstIndex node;
+
+  eat(KW_PROGRAM);
+  eat(TK_IDENT);
+
+  program = createProgramObject(currentToken->string);
+  locateObject(program);
+  enterBlock(program->progAttrs->scope);
+
+  eat(SB_SEMICOLON);
+  compileUses();
+
+  node = createObjectNode(AST_PROGRAM, program);
+  addAstChild(node, buildBlock(program));
+  eat(SB_PERIOD);
+
+  exitBlock();
+  return node;
+}
+
+// The subprograms of a unit, for kplc --lsp: this tree is not generated
+AstIndex buildUnit(void) {
+  Object* unit;
+  AstIndex node;
+
+  eat(KW_UNIT);
+  eat(TK_IDENT);
+
+  unit = createProgramObject(currentToken->string);
+  locateObject(unit);
+  useUnit(currentToken->string);
+  enterBlock(unit->progAttrs->scope);
+
+  eat(SB_SEMICOLON);
+  compileUses();
+
+  compileConstDecls();
+  compileTypeDecls();
+  node = createObjectNode(AST_BLOCK, unit);
+  buildSubDecls(node);
+  eat(SB_PERIOD);
+
+  exitBlock();
+  return node;
+}
+
+AstIndex buildBlock(Object* owner) {
+  AstIndex block = createObjectNode(AST_BLOCK, owner);
+  AstIndex body;
+
+  compileConstDecls();
+  compileTypeDecls();
+  compileVarDecls();
+  buildSubDecls(block);
+
+  eat(KW_BEGIN);
+  body = createAstNode(AST_GROUP);
+  buildStatements(body);
+  eat(KW_END);
+
+  addAstChild(block, body);
+  return block;
+}
+
+void buildSubDecls(AstIndex block) {
+  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE)) {
+    if (lookAhead->tokenType == KW_FUNCTION)
+      addAstChild(block, buildFuncDecl());
+    else addAstChild(block, buildProcDecl());
+  }
+}
+
+AstIndex buildFuncDecl(void) {
+  Object* funcObj = compileFuncHeader();
+  AstIndex node;
+
+  node = createObjectNode(AST_FUNCTION, funcObj);
+  addAstChild(node, buildBlock(funcObj));
+
+  eat(SB_SEMICOLON);
+
+  exitBlock();
+  return node;
+}
+
+AstIndex buildProcDecl(void) {
+  Object* procObj = compileProcHeader();
+  AstIndex node;
+
+  node = createObjectNode(AST_PROCEDURE, procObj);
+  addAstChild(node, buildBlock(procObj));
+
+  eat(SB_SEMICOLON);
+
+  exitBlock();
+  return node;
+}
+
+// Parse the whole program into the tree, then generate its code
+int compileAst(char *fileName) {
+  AstIndex program;
+
+  if (openInputStream(fileName) == IO_ERROR)
+    return IO_ERROR;
+
+  enterPhase(PHASE_PARSER);
+  currentToken = NULL;
+  lookAhead = getValidToken();
+
+  initSymTab();
+  initAst();
+  sourceFileName = fileName;
+
+  // A unit has no body, its code is generated as it is parsed
+  if (lookAhead->tokenType == KW_UNIT) {
+    compileUnitFile();
+    leavePhase();
+  } else {
+    program = buildProgram();
+    leavePhase();
+
+    // The optimizations of a subprogram read and rewrite the code of
+    // others, so only unoptimized code is generated in parallel
+    enterPhase(PHASE_CODEGEN);
+    if ((codeThreads > 1) && (optimizationLevel == 0))
+      genProgramInParallel(program, codeThreads);
+    else genProgramNode(program);
+    leavePhase();
+  }
+
+  // Nothing is removed from the symbol table before the end
+  if (collectStats)
+    setSymbolCount(countSymbols());
+  cleanSymTab();
+  cleanAst();
+  free(currentToken);
+  free(lookAhead);
+  closeInputStream();
+  return IO_SUCCESS;
+}
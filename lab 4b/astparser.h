@@ -0,0 +1,21 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ASTPARSER_H__
+#define __ASTPARSER_H__
+
+#include "ast.h"
+
+AstIndex buildProgram(void);
+AstIndex buildUnit(void);
+AstIndex buildBlock(Object* owner);
+void buildSubDecls(AstIndex block);
+AstIndex buildFuncDecl(void);
+AstIndex buildProcDecl(void);
+
+int compileAst(char *fileName);
+
+#endif
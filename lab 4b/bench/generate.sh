@@ -0,0 +1,118 @@
+#!/bin/bash
+# Generate synthetic KPL programs on stdout
+# Usage: bench/generate.sh KIND SIZE
+#   nesting    SIZE nested If statements
+#   decls      SIZE constants and SIZE variables
+#   expression an assignment of an expression of SIZE terms
+#   loop       nested loops running n * SIZE times (n is read)
+#   recursion  a chain of SIZE functions over a recursive Fibonacci (n is read)
+
+KIND=$1
+SIZE=$2
+
+gen_nesting() {
+  echo "Program Nesting;"
+  echo "Var n : Integer;"
+  echo "    S : Integer;"
+  echo "Begin"
+  echo "  n := ReadI;"
+  echo "  S := 0;"
+  for ((i = 0; i < SIZE; i++)); do
+    echo "  If n > $i Then Begin S := S + 1;"
+  done
+  echo "  S := S + n"
+  for ((i = 0; i < SIZE; i++)); do
+    echo "  End;"
+  done
+  echo "  Call WriteI(S);"
+  echo "  Call WriteLN"
+  echo "End."
+}
+
+gen_decls() {
+  echo "Program Decls;"
+  echo "Const"
+  for ((i = 0; i < SIZE; i++)); do
+    echo "  c$i = $i;"
+  done
+  echo "Var"
+  for ((i = 0; i < SIZE; i++)); do
+    echo "  v$i : Integer;"
+  done
+  echo "Begin"
+  for ((i = 0; i < SIZE; i += 10)); do
+    echo "  v$i := c$i;"
+  done
+  echo "  Call WriteI(v0);"
+  echo "  Call WriteLN"
+  echo "End."
+}
+
+gen_expression() {
+  echo "Program Expression;"
+  echo "Var n : Integer;"
+  echo "    S : Integer;"
+  echo "Begin"
+  echo "  n := ReadI;"
+  echo "  S := n"
+  for ((i = 1; i <= SIZE; i++)); do
+    case $((i % 4)) in
+      0) echo "    + (n - $i) * 2" ;;
+      1) echo "    - n / $i" ;;
+      2) echo "    + $i" ;;
+      3) echo "    - (n + $i)" ;;
+    esac
+  done
+  echo "  ;"
+  echo "  Call WriteI(S);"
+  echo "  Call WriteLN"
+  echo "End."
+}
+
+gen_loop() {
+  echo "Program Loop;"
+  echo "Var n : Integer;"
+  echo "    i : Integer;"
+  echo "    j : Integer;"
+  echo "    S : Integer;"
+  echo "Begin"
+  echo "  n := ReadI;"
+  echo "  S := 0;"
+  echo "  For i := 1 To n Do"
+  echo "    For j := 1 To $SIZE Do"
+  echo "      S := S + i * j - S / 3;"
+  echo "  Call WriteI(S);"
+  echo "  Call WriteLN"
+  echo "End."
+}
+
+gen_recursion() {
+  echo "Program Recursion;"
+  echo "Var n : Integer;"
+  echo "Function F0(d : Integer) : Integer;"
+  echo "Begin"
+  echo "  If d <= 1 Then F0 := 1"
+  echo "  Else F0 := F0(d - 1) + F0(d - 2)"
+  echo "End;"
+  for ((i = 1; i < SIZE; i++)); do
+    echo "Function F$i(d : Integer) : Integer;"
+    echo "Begin"
+    echo "  F$i := F$((i - 1))(d) + 1"
+    echo "End;"
+  done
+  echo "Begin"
+  echo "  n := ReadI;"
+  echo "  Call WriteI(F$((SIZE - 1))(n));"
+  echo "  Call WriteLN"
+  echo "End."
+}
+
+case "$KIND" in
+  nesting|decls|expression|loop|recursion)
+    gen_$KIND
+    ;;
+  *)
+    echo "Usage: $0 nesting|decls|expression|loop|recursion SIZE" >&2
+    exit 1
+    ;;
+esac
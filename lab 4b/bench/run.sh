@@ -0,0 +1,58 @@
+#!/bin/bash
+# Run the KPL benchmarks with kplc and kplrun (build them with make first)
+
+set +e
+
+BENCH_DIR="bench"
+TMP_DIR="bench/_tmp_output"
+
+mkdir -p "$TMP_DIR"
+
+TIMEFORMAT="   time : %3R s"
+
+run_bench() {
+  NAME=$1
+  INPUT=$2
+  FLAGS=$3
+
+  # The sample programs of the tests can be run as well
+  SOURCE="$BENCH_DIR/$NAME.kpl"
+  if [ ! -f "$SOURCE" ]; then
+    SOURCE="tests/$NAME.kpl"
+  fi
+
+  echo "----------------------------------------"
+  echo "Benchmark $NAME.kpl (input: $INPUT) $FLAGS"
+
+  ./kplc "$SOURCE" "$TMP_DIR/$NAME" $FLAGS
+  if [ $? -ne 0 ]; then
+    echo "❌ kplc failed"
+    return
+  fi
+
+  time (echo "$INPUT" | ./kplrun "$TMP_DIR/$NAME" > /dev/null)
+}
+
+echo "========================================"
+echo "Running KPL benchmarks"
+echo "========================================"
+
+# Call overhead: 2^(n+1) - 1 procedure calls and fib(n) function calls
+run_bench calls 20
+
+# Tiny accessors called in an inner loop, with and without inlining
+run_bench accessors 20000
+run_bench accessors 20000 -O2
+
+# Arithmetic in a WHILE loop
+run_bench arith 10000000
+run_bench arith 10000000 -O1
+
+# Millions of integers written by the buffered output of the VM
+run_bench output 2000000
+
+# A FOR loop of 10^9 iterations, with the fused loop instructions at -O1
+run_bench example4 1000000000
+run_bench example4 1000000000 -O1
+
+echo "========================================"
@@ -0,0 +1,140 @@
+#!/bin/bash
+# Run the synthetic benchmark suite and write the results as JSON
+# Usage: bench/suite.sh [RESULTS]  (build kplc and kplrun with make first)
+#
+# The compile benchmarks report the phases of kplc -stats (scanner, parser,
+# codegen, optimizer, serializer), the symbol table size and the code size;
+# the run benchmarks report the wall time of kplrun.
+
+set +e
+
+BENCH_DIR="bench"
+TMP_DIR="bench/_tmp_output"
+RESULTS=${1:-"$TMP_DIR/results.json"}
+REPEAT=${REPEAT:-3}
+
+mkdir -p "$TMP_DIR"
+
+FIRST=1
+FAILED=0
+
+# Milliseconds elapsed since START (set with START=$(date +%s%N))
+elapsed() {
+  echo "$START $(date +%s%N)" | awk '{ printf "%.3f", ($2 - $1) / 1000000 }'
+}
+
+# Append one JSON object to the results
+emit() {
+  if [ $FIRST -eq 0 ]; then
+    echo "," >> "$RESULTS"
+  fi
+  FIRST=0
+  echo -n "    $1" >> "$RESULTS"
+}
+
+# Compile a generated program REPEAT times and keep the fastest run
+compile_bench() {
+  KIND=$1
+  SIZE=$2
+  NAME="${KIND}_$SIZE"
+  SOURCE="$TMP_DIR/$NAME.kpl"
+
+  bash "$BENCH_DIR/generate.sh" "$KIND" "$SIZE" > "$SOURCE"
+
+  BEST=""
+  for ((r = 0; r < REPEAT; r++)); do
+    ./kplc "$SOURCE" "$TMP_DIR/$NAME" -stats > "$TMP_DIR/$NAME.stats"
+    if [ $? -ne 0 ] || grep -q "^[0-9]*-[0-9]*:" "$TMP_DIR/$NAME.stats"; then
+      echo "❌ compile $NAME failed"
+      FAILED=1
+      return
+    fi
+    TOTAL=$(awk '$1 == "total" { print $2 }' "$TMP_DIR/$NAME.stats")
+    if [ -z "$BEST" ] || awk "BEGIN { exit !($TOTAL < $BEST) }"; then
+      BEST=$TOTAL
+      cp "$TMP_DIR/$NAME.stats" "$TMP_DIR/$NAME.best"
+    fi
+  done
+
+  JSON=$(awk -v name="$NAME" -v size="$SIZE" '
+    $1 ~ /^(driver|scanner|parser|codegen|optimizer|serializer|total)$/ {
+      phases = phases sep "\"" $1 "\": " $2; sep = ", "
+      if ($1 == "total") { allocs = $3; bytes = $4 }
+    }
+    /^Symbol table:/ { symbols = $3 }
+    /^Code size:/ { code = $3 }
+    END {
+      printf "{\"name\": \"compile_%s\", \"kind\": \"compile\", \"size\": %d, ", name, size
+      printf "\"ms\": {%s}, \"allocations\": %d, \"bytes\": %d, ", phases, allocs, bytes
+      printf "\"symbols\": %d, \"code_size\": %d}", symbols, code
+    }' "$TMP_DIR/$NAME.best")
+  emit "$JSON"
+  echo "compile $NAME : $BEST ms"
+}
+
+# Run a generated program REPEAT times with INPUT and keep the fastest run
+run_bench() {
+  KIND=$1
+  SIZE=$2
+  INPUT=$3
+  FLAGS=$4
+  NAME="${KIND}_$SIZE${FLAGS// /}"
+  SOURCE="$TMP_DIR/$NAME.kpl"
+
+  bash "$BENCH_DIR/generate.sh" "$KIND" "$SIZE" > "$SOURCE"
+  ./kplc "$SOURCE" "$TMP_DIR/$NAME" $FLAGS > /dev/null
+  if [ $? -ne 0 ]; then
+    echo "❌ compile $NAME failed"
+    FAILED=1
+    return
+  fi
+
+  BEST=""
+  for ((r = 0; r < REPEAT; r++)); do
+    START=$(date +%s%N)
+    echo "$INPUT" | ./kplrun "$TMP_DIR/$NAME" > "$TMP_DIR/$NAME.out"
+    STATUS=$?
+    TIME=$(elapsed)
+    if [ $STATUS -ne 0 ]; then
+      echo "❌ run $NAME failed"
+      FAILED=1
+      return
+    fi
+    if [ -z "$BEST" ] || awk "BEGIN { exit !($TIME < $BEST) }"; then
+      BEST=$TIME
+    fi
+  done
+
+  emit "{\"name\": \"run_$NAME\", \"kind\": \"run\", \"size\": $SIZE, \"input\": $INPUT, \"flags\": \"$FLAGS\", \"ms\": {\"total\": $BEST}}"
+  echo "run $NAME $FLAGS : $BEST ms"
+}
+
+echo "{" > "$RESULTS"
+echo "  \"repeat\": $REPEAT," >> "$RESULTS"
+echo "  \"benchmarks\": [" >> "$RESULTS"
+
+# Parser: deeply nested statements
+compile_bench nesting 800
+
+# Scanner and symbol table: huge constant and variable sections
+compile_bench decls 2000
+
+# Code generation: one very long expression
+compile_bench expression 1500
+
+# Parser: an expression far too long for a recursive parser, and for the
+# initial code buffer
+compile_bench expression 1000000
+
+# VM: big loops and recursive calls
+run_bench loop 1000 10000
+run_bench loop 1000 10000 -O1
+run_bench recursion 50 30
+run_bench recursion 50 30 -O2
+
+echo "" >> "$RESULTS"
+echo "  ]" >> "$RESULTS"
+echo "}" >> "$RESULTS"
+
+echo "Results written to $RESULTS"
+exit $FAILED
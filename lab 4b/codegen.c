@@ -5,11 +5,17 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "reader.h"
 #include "codegen.h"  
+#include "linker.h"
+#include "optimizer.h"
+#include "stats.h"
 
+// Initial size of the code buffers, which grow as the code is generated
 #define CODE_SIZE 10000
-extern SymTab* symtab;
+extern __thread SymTab* symtab;
 
 extern Object* readiFunction;
 extern Object* readcFunction;
@@ -17,7 +23,17 @@ extern Object* writeiProcedure;
 extern Object* writecProcedure;
 extern Object* writelnProcedure;
 
-CodeBlock* codeBlock;
+// Each thread generating code has its own buffer
+__thread CodeBlock* codeBlock;
+
+// The subprograms of the units used, called at -(index + 1) until linked
+Symbol* externals = NULL;
+int externalCount = 0;
+
+// The subprograms of the unit compiled
+Symbol* exports = NULL;
+int exportCount = 0;
+int compilingUnit = 0;
 
 int computeNestedLevel(Scope* scope) {
   int level = 0;
@@ -59,11 +75,102 @@ void genReturnValueAddress(Object* func) {
   genLA(level, offset);
 }
 
+// A subprogram of another unit is global, and is called as if it was 
+// declared in the program
+int computeCallLevel(Scope* outer) {
+  int level = computeNestedLevel(outer);
+  return (outer == NULL) ? level - 1 : level;
+}
+
 void genFunctionCall(Object* func) {
-  int level = computeNestedLevel(func->funcAttrs->scope->outer);
+  int level = computeCallLevel(func->funcAttrs->scope->outer);
   genCALL(level, func->funcAttrs->codeAddress);
 }
 
+void genProcedureCall(Object* proc) {
+  int level = computeCallLevel(proc->procAttrs->scope->outer);
+  genCALL(level, proc->procAttrs->codeAddress);
+}
+
+// The body of the block being generated starts with the INT allocating its frame
+CodeAddress getCurrentBodyAddress(void) {
+  Object* owner = symtab->currentScope->owner;
+
+  switch (owner->kind) {
+  case OBJ_FUNCTION:
+    return codeBlock->code[owner->funcAttrs->codeAddress].q;
+  case OBJ_PROCEDURE:
+    return codeBlock->code[owner->procAttrs->codeAddress].q;
+  default:
+    return codeBlock->code[owner->progAttrs->codeAddress].q;
+  }
+}
+
+// Replace the call of a small subprogram by its body. The reserved words 
+// and the arguments have been pushed from callAddress on.
+int genInlinedCall(Object* sub, CodeAddress callAddress) {
+  CodeAddress codeAddress;
+  CodeAddress bodyAddress;
+  Scope* scope;
+  int paramCount;
+  WORD frameBase;
+
+  if (sub->kind == OBJ_FUNCTION) {
+    codeAddress = sub->funcAttrs->codeAddress;
+    scope = sub->funcAttrs->scope;
+    paramCount = sub->funcAttrs->paramCount;
+  } else {
+    codeAddress = sub->procAttrs->codeAddress;
+    scope = sub->procAttrs->scope;
+    paramCount = sub->procAttrs->paramCount;
+  }
+
+  enterPhase(PHASE_OPTIMIZER);
+  if (!isInlinable(codeAddress)) {
+    leavePhase();
+    return 0;
+  }
+
+  // The frame would start where CALL sets the base
+  bodyAddress = getCurrentBodyAddress();
+  frameBase = symtab->currentScope->frameSize + getStackDepth(bodyAddress, callAddress);
+  if (sub->kind == OBJ_PROCEDURE) 
+    frameBase --;
+
+  inlineBody(codeAddress, computeNestedLevel(scope->outer), frameBase, RESERVED_WORDS + paramCount);
+  leavePhase();
+  return 1;
+}
+
+// Compute the invariant code [start, end) of the loop generated from 
+// loopStart into a temporary. Returns the number of instructions added.
+int genHoistedInvariant(CodeAddress loopStart, CodeAddress start, CodeAddress end) {
+  int depth;
+  int growth = 0;
+
+  enterPhase(PHASE_OPTIMIZER);
+  depth = getStackDepth(getCurrentBodyAddress(), loopStart);
+  if (depth != UNKNOWN_DEPTH) 
+    growth = hoistInvariantCode(loopStart, start, end, symtab->currentScope->frameSize + depth);
+  leavePhase();
+  return growth;
+}
+
+// Use the fused loop instructions for the FOR loop generated from 
+// varCode, if its bound [toCode, toEnd) is invariant
+int genFusedForLoop(CodeAddress varCode, CodeAddress fromCode, CodeAddress toCode, CodeAddress toEnd) {
+  int depth;
+  int fused = 0;
+
+  enterPhase(PHASE_OPTIMIZER);
+  depth = getStackDepth(getCurrentBodyAddress(), varCode);
+  // The bound lies above the address of the variable
+  if (depth != UNKNOWN_DEPTH) 
+    fused = fuseForLoop(varCode, fromCode, toCode, toEnd, symtab->currentScope->frameSize + depth + 1);
+  leavePhase();
+  return fused;
+}
+
 int isPredefinedFunction(Object* func) {
   return ((func == readiFunction) || (func == readcFunction));
 }
@@ -112,16 +219,30 @@ void genDCT(int delta) {
   emitDCT(codeBlock,delta);
 }
 
-Instruction* genJ(CodeAddress label) {
-  Instruction* inst = codeBlock->code + codeBlock->codeSize;
+// The jumps are returned by address, the buffer moves as it grows
+CodeAddress genJ(CodeAddress label) {
+  CodeAddress address = codeBlock->codeSize;
   emitJ(codeBlock,label);
-  return inst;
+  return address;
 }
 
-Instruction* genFJ(CodeAddress label) {
-  Instruction* inst = codeBlock->code + codeBlock->codeSize;
+CodeAddress genFJ(CodeAddress label) {
+  CodeAddress address = codeBlock->codeSize;
   emitFJ(codeBlock, label);
-  return inst;
+  return address;
+}
+
+// Jump to label if the condition just generated is false, fusing the
+// comparison with the jump
+CodeAddress genFalseJump(CodeAddress label) {
+  Instruction* inst = codeBlock->code + codeBlock->codeSize - 1;
+  enum OpCode op = getFalseJump(inst->op);
+
+  if (op == OP_FJ) 
+    return genFJ(label);
+  inst->op = op;
+  inst->q = label;
+  return codeBlock->codeSize - 1;
 }
 
 void genHL(void) {
@@ -212,21 +333,94 @@ void genLE(void) {
   emitLE(codeBlock);
 }
 
-void updateJ(Instruction* jmp, CodeAddress label) {
-  jmp->q = label;
+void genBC(WORD size) {
+  emitBC(codeBlock, size);
+}
+
+void genInstruction(enum OpCode op, WORD p, WORD q) {
+  emitCode(codeBlock, op, p, q);
 }
 
-void updateFJ(Instruction* jmp, CodeAddress label) {
-  jmp->q = label;
+void updateJ(CodeAddress jmp, CodeAddress label) {
+  codeBlock->code[jmp].q = label;
+}
+
+void updateFJ(CodeAddress jmp, CodeAddress label) {
+  codeBlock->code[jmp].q = label;
 }
 
 CodeAddress getCurrentCodeAddress(void) {
   return codeBlock->codeSize;
 }
 
+Instruction* getInstruction(CodeAddress address) {
+  return codeBlock->code + address;
+}
+
+// Check whether the code generated since start is a single constant load
+int isConstantCode(CodeAddress start, WORD* value) {
+  Instruction* inst = codeBlock->code + start;
+
+  if ((codeBlock->codeSize != start + 1) || (inst->op != OP_LC))
+    return 0;
+  *value = inst->q;
+  return 1;
+}
+
+// Replace count instructions from address by the n given ones.
+// Jump targets located after the replaced ones are moved accordingly.
+int replaceCode(CodeAddress address, int count, Instruction* code, int n) {
+  Instruction* inst;
+  int delta = n - count;
+  int i;
+
+  if (!growCodeBlock(codeBlock, codeBlock->codeSize + delta)) return 0;
+
+  for (i = 0; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if (isJumpInstruction(inst->op) && (inst->q >= address + count))
+      inst->q += delta;
+  }
+
+  if (delta > 0)
+    for (i = codeBlock->codeSize - 1; i >= address + count; i --)
+      codeBlock->code[i + delta] = codeBlock->code[i];
+  else if (delta < 0)
+    for (i = address + count; i < codeBlock->codeSize; i ++)
+      codeBlock->code[i + delta] = codeBlock->code[i];
+  codeBlock->codeSize += delta;
+
+  for (i = 0; i < n; i ++)
+    codeBlock->code[address + i] = code[i];
+  return 1;
+}
+
+void removeCode(CodeAddress address) {
+  replaceCode(address, 1, NULL, 0);
+}
+
+// The code buffer can't grow: the jumps still to patch and the
+// optimizations would work on a truncated code, the compilation stops there
+void stopCodeOverflow(void) {
+  printf("Code too large!\n");
+  exit(-1);
+}
 
 void initCodeBuffer(void) {
   codeBlock = createCodeBlock(CODE_SIZE);
+  codeOverflow = stopCodeOverflow;
+}
+
+CodeBlock* createCodeBuffer(void) {
+  return createCodeBlock(CODE_SIZE);
+}
+
+// Generate into another buffer, returns the current one
+CodeBlock* switchCodeBuffer(CodeBlock* block) {
+  CodeBlock* current = codeBlock;
+
+  codeBlock = block;
+  return current;
 }
 
 void printCodeBuffer(void) {
@@ -237,12 +431,73 @@ void cleanCodeBuffer(void) {
   freeCodeBlock(codeBlock);
 }
 
+CodeAddress declareExternal(char* name) {
+  externals = (Symbol*) realloc(externals, (externalCount + 1) * sizeof(Symbol));
+  memset(externals + externalCount, 0, sizeof(Symbol));
+  strncpy(externals[externalCount].name, name, MAX_IDENT_LEN);
+  externals[externalCount].address = DC_VALUE;
+  externalCount ++;
+  return - externalCount;
+}
+
+int getExternalCount(void) {
+  return externalCount;
+}
+
+void addExport(char* name, CodeAddress address) {
+  exports = (Symbol*) realloc(exports, (exportCount + 1) * sizeof(Symbol));
+  memset(exports + exportCount, 0, sizeof(Symbol));
+  strncpy(exports[exportCount].name, name, MAX_IDENT_LEN);
+  exports[exportCount].address = address;
+  exportCount ++;
+}
+
+// The subprograms declared in the scope of the unit compiled
+void declareExports(Scope* scope) {
+  ObjectNode* node;
+
+  compilingUnit = 1;
+  for (node = scope->objList; node != NULL; node = node->next)
+    if (node->object->kind == OBJ_FUNCTION)
+      addExport(node->object->name, node->object->funcAttrs->codeAddress);
+    else if (node->object->kind == OBJ_PROCEDURE)
+      addExport(node->object->name, node->object->procAttrs->codeAddress);
+}
+
+// A unit, or a program using units, is saved as an object for kpllink
+void saveObject(FILE* f) {
+  Symbol* calls = (Symbol*) malloc((codeBlock->codeSize + 1) * sizeof(Symbol));
+  ObjectCode object;
+  Instruction* inst;
+  int i;
+
+  object.callCount = 0;
+  for (i = 0; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if ((inst->op == OP_CALL) && (inst->q < 0)) {
+      calls[object.callCount] = externals[- inst->q - 1];
+      calls[object.callCount].address = i;
+      object.callCount ++;
+    }
+  }
+
+  object.isUnit = compilingUnit;
+  object.codeBlock = codeBlock;
+  object.exports = exports;
+  object.exportCount = exportCount;
+  object.calls = calls;
+  saveObjectCode(&object, f);
+  free(calls);
+}
+
 int serialize(char* fileName) {
   FILE* f;
 
   f = fopen(fileName, "wb");
   if (f == NULL) return IO_ERROR;
-  saveCode(codeBlock, f);
+  if (compilingUnit || (externalCount > 0))
+    saveObject(f);
+  else saveCode(codeBlock, f);
   fclose(f);
   return IO_SUCCESS;
 }
@@ -12,11 +12,11 @@
 
 #define RESERVED_WORDS 4
 
-#define PROCEDURE_PARAM_COUNT(proc) (proc->procAttrs->numOfParams)
+#define PROCEDURE_PARAM_COUNT(proc) (proc->procAttrs->paramCount)
 #define PROCEDURE_SCOPE(proc) (proc->procAttrs->scope)
 #define PROCEDURE_FRAME_SIZE(proc) (proc->procAttrs->scope->frameSize)
 
-#define FUNCTION_PARAM_COUNT(func) (func->funcAttrs->numOfParams)
+#define FUNCTION_PARAM_COUNT(func) (func->funcAttrs->paramCount)
 #define FUNCTION_SCOPE(func) (func->funcAttrs->scope)
 #define FUNCTION_FRAME_SIZE(func) (func->funcAttrs->scope->frameSize)
 
@@ -34,6 +34,10 @@
 #define RETURN_ADDRESS_OFFSET 2
 #define STATIC_LINK_OFFSET 3
 
+// A procedure has no return value. Its frame starts one word lower, 
+// the unused return value slot overlapping the top of the caller's stack.
+#define PROCEDURE_RESERVED_WORDS (RESERVED_WORDS - 1)
+
 void genVariableAddress(Object* var);
 void genVariableValue(Object* var);
 
@@ -44,6 +48,10 @@ void genParameterAddress(Object* param);
 void genParameterValue(Object* param);
 void genReturnValueAddress(Object* func);
 void genFunctionCall(Object* func);
+void genProcedureCall(Object* proc);
+int genInlinedCall(Object* sub, CodeAddress callAddress);
+int genHoistedInvariant(CodeAddress loopStart, CodeAddress start, CodeAddress end);
+int genFusedForLoop(CodeAddress varCode, CodeAddress fromCode, CodeAddress toCode, CodeAddress toEnd);
 
 void genLA(int level, int offset);
 void genLV(int level, int offset);
@@ -51,8 +59,9 @@ void genLC(WORD constant);
 void genLI(void);
 void genINT(int delta);
 void genDCT(int delta);
-Instruction* genJ(CodeAddress label);
-Instruction* genFJ(CodeAddress label);
+CodeAddress genJ(CodeAddress label);
+CodeAddress genFJ(CodeAddress label);
+CodeAddress genFalseJump(CodeAddress label);
 void genHL(void);
 void genST(void);
 void genCALL(int level, CodeAddress label);
@@ -75,18 +84,33 @@ void genGT(void);
 void genGE(void);
 void genLT(void);
 void genLE(void);
+void genBC(WORD size);
+void genInstruction(enum OpCode op, WORD p, WORD q);
+
+void updateJ(CodeAddress jmp, CodeAddress label);
+void updateFJ(CodeAddress jmp, CodeAddress label);
 
-void updateJ(Instruction* jmp, CodeAddress label);
-void updateFJ(Instruction* jmp, CodeAddress label);
+Instruction* getInstruction(CodeAddress address);
+int isConstantCode(CodeAddress start, WORD* value);
+int replaceCode(CodeAddress address, int count, Instruction* code, int n);
+void removeCode(CodeAddress address);
 
 CodeAddress getCurrentCodeAddress(void);
+CodeAddress getCurrentBodyAddress(void);
 int isPredefinedProcedure(Object* proc);
 int isPredefinedFunction(Object* func);
 
+void stopCodeOverflow(void);
 void initCodeBuffer(void);
+CodeBlock* createCodeBuffer(void);
+CodeBlock* switchCodeBuffer(CodeBlock* block);
 void printCodeBuffer(void);
 void cleanCodeBuffer(void);
 
+CodeAddress declareExternal(char* name);
+int getExternalCount(void);
+void declareExports(Scope* scope);
+
 int serialize(char* fileName);
 
 #endif
@@ -101,3 +101,53 @@ void printScope(Scope* scope, int indent) {
   printObjectList(scope->objList, indent);
 }
 
+// The objects declared, with their line and column, and the bytes of the
+// bodies skipped. A unit is kept as a program object.
+void printOutline(Object* obj, int indent, int isUnit) {
+  Scope* scope = NULL;
+  ObjectNode* node;
+
+  pad(indent);
+  switch (obj->kind) {
+  case OBJ_CONSTANT:
+    printf("Const %s = ", obj->name);
+    printConstantValue(obj->constAttrs->value);
+    break;
+  case OBJ_TYPE:
+    printf("Type %s = ", obj->name);
+    printType(obj->typeAttrs->actualType);
+    break;
+  case OBJ_VARIABLE:
+    printf("Var %s : ", obj->name);
+    printType(obj->varAttrs->type);
+    break;
+  case OBJ_PARAMETER:
+    if (obj->paramAttrs->kind == PARAM_VALUE) 
+      printf("Param %s : ", obj->name);
+    else
+      printf("Param VAR %s : ", obj->name);
+    printType(obj->paramAttrs->type);
+    break;
+  case OBJ_FUNCTION:
+    printf("Function %s : ", obj->name);
+    printType(obj->funcAttrs->returnType);
+    scope = obj->funcAttrs->scope;
+    break;
+  case OBJ_PROCEDURE:
+    printf("Procedure %s", obj->name);
+    scope = obj->procAttrs->scope;
+    break;
+  case OBJ_PROGRAM:
+    printf(isUnit ? "Unit %s" : "Program %s", obj->name);
+    scope = obj->progAttrs->scope;
+    break;
+  }
+  printf(" at %d:%d", obj->lineNo, obj->colNo);
+  if ((scope != NULL) && (scope->bodyEnd > 0))
+    printf(", body at bytes %ld-%ld", scope->bodyStart, scope->bodyEnd);
+  printf("\n");
+
+  if (scope != NULL)
+    for (node = scope->objList; node != NULL; node = node->next)
+      printOutline(node->object, indent + 4, 0);
+}
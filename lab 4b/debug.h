@@ -14,5 +14,6 @@ void printConstantValue(ConstantValue* value);
 void printObject(Object* obj, int indent);
 void printObjectList(ObjectNode* objList, int indent);
 void printScope(Scope* scope, int indent);
+void printOutline(Object* obj, int indent, int isUnit);
 
 #endif
@@ -0,0 +1,168 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "astparser.h"
+#include "codegen.h"
+#include "stats.h"
+#include "driver.h"
+#include "xref.h"
+
+
+int dumpCode = 0;
+int boundsCheck = 0;
+int optimizationLevel = 0;
+int useAst = 0;
+int codeThreads = 1;
+
+// kplc is linked with --wrap for malloc and calloc, to count 
+// the allocations of each phase
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  countAllocation(size);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  countAllocation(count * size);
+  return __real_calloc(count, size);
+}
+
+void printUsage(void) {
+  printf("Usage: kplc input output [-dump] [-stats] [-ast] [-jN] [-xref]\n");
+  printf("            [-fbounds-check] [-O0|-O1|-O2]\n");
+  printf("       kplc --outline input\n");
+  printf("   --outline: list the declarations of input and where they are, without\n");
+  printf("              parsing the bodies\n");
+  printf("   input: input kpl program or unit\n");
+  printf("   output: executable, or object for kpllink if the input is a unit or uses units\n");
+  printf("   -dump: code dump\n");
+  printf("   -stats: time and allocations of the phases, sizes of the symbol table and the code\n");
+  printf("   -ast: build a syntax tree of the whole program, then generate its code\n");
+  printf("   -jN: -ast, and generate the subprograms on N threads (-O0 only)\n");
+  printf("   -xref: save the definitions and uses of the names in input.kpx, for kplx\n");
+  printf("   -fbounds-check: check array indexes at runtime\n");
+  printf("   -O1: eliminate tail calls and unused variables, hoist loop invariants\n");
+  printf("       step FOR loops and branch on comparisons in one instruction\n");
+  printf("   -O2: -O1, and inline small subprograms\n");
+}
+
+int analyseParam(char* param) {
+  if (strcmp(param, "-dump") == 0) {
+    dumpCode = 1;
+    return 1;
+  } 
+  if (strcmp(param, "-stats") == 0) {
+    initStats();
+    return 1;
+  } 
+  if (strcmp(param, "-ast") == 0) {
+    useAst = 1;
+    return 1;
+  } 
+  if ((strncmp(param, "-j", 2) == 0) && (atoi(param + 2) > 0)) {
+    useAst = 1;
+    codeThreads = atoi(param + 2);
+    return 1;
+  }
+  if (strcmp(param, "-xref") == 0) {
+    indexing = 1;
+    return 1;
+  }
+  if (strcmp(param, "-fbounds-check") == 0) {
+    boundsCheck = 1;
+    return 1;
+  } 
+  if ((strlen(param) == 3) && (strncmp(param, "-O", 2) == 0) && 
+      (param[2] >= '0') && (param[2] <= '2')) {
+    optimizationLevel = param[2] - '0';
+    return 1;
+  }
+  return 0;
+}
+
+
+// input.kpl gives input.kpx
+char* getIndexFileName(char* inputName) {
+  int length = strlen(inputName);
+  char* fileName = (char*) malloc(length + 5);
+
+  if ((length > 4) && (strcmp(inputName + length - 4, ".kpl") == 0))
+    length -= 4;
+  strncpy(fileName, inputName, length);
+  strcpy(fileName + length, ".kpx");
+  return fileName;
+}
+
+/******************************************************************/
+
+// Compile as kplc does with the arguments
+int runCompiler(int argc, char *argv[]) {
+  char* indexName;
+  int i; 
+
+  if (argc <= 1) {
+    printf("kplc: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  if (argc <= 2) {
+    printf("kplc: no output file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for ( i = 3; i < argc; i ++) 
+    analyseParam(argv[i]);
+
+  initCodeBuffer();
+
+  if ((useAst ? compileAst(argv[1]) : compile(argv[1])) == IO_ERROR) {
+    printf("Can\'t read input file!\n");
+    return -1;
+  }
+
+  enterPhase(PHASE_SERIALIZER);
+  if (serialize(argv[2]) == IO_ERROR) {
+    printf("Can\'t write output file!\n");
+    return -1;
+  }
+  if (indexing) {
+    indexName = getIndexFileName(argv[1]);
+    if (saveIndex(indexName, argv[1]) == IO_ERROR)
+      printf("Can\'t write index file %s!\n", indexName);
+    free(indexName);
+  }
+  leavePhase();
+
+  if (dumpCode) printCodeBuffer();
+  if (collectStats) printStats(getCurrentCodeAddress());
+    
+  cleanCodeBuffer();
+
+  return 0;
+}
+
+// kplc --outline input
+int runOutline(char* fileName) {
+  int result = 0;
+
+  initCodeBuffer();
+  if (compileOutline(fileName) == IO_ERROR) {
+    printf("Can\'t read input file!\n");
+    result = -1;
+  }
+  cleanCodeBuffer();
+  return result;
+}
@@ -0,0 +1,13 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __DRIVER_H__
+#define __DRIVER_H__
+
+int runCompiler(int argc, char *argv[]);
+int runOutline(char* fileName);
+
+#endif
@@ -8,14 +8,14 @@
 #include <stdlib.h>
 #include "error.h"
 
-#define NUM_OF_ERRORS 29
+#define NUM_OF_ERRORS 30
 
 struct ErrorMessage {
   ErrorCode errorCode;
   char *message;
 };
 
-struct ErrorMessage errors[29] = {
+struct ErrorMessage errors[30] = {
   {ERR_END_OF_COMMENT, "End of comment expected."},
   {ERR_IDENT_TOO_LONG, "Identifier too long."},
   {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
@@ -42,21 +42,40 @@ struct ErrorMessage errors[29] = {
   {ERR_UNDECLARED_VARIABLE, "Undeclared variable."},
   {ERR_UNDECLARED_FUNCTION, "Undeclared function."},
   {ERR_UNDECLARED_PROCEDURE, "Undeclared procedure."},
+  {ERR_UNDECLARED_UNIT, "Unit not found."},
   {ERR_DUPLICATE_IDENT, "Duplicate identifier."},
   {ERR_TYPE_INCONSISTENCY, "Type inconsistency"},
   {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."}
 };
 
+jmp_buf* errorRecovery = NULL;
+char errorMessage[MAX_ERROR_LEN];
+int errorLineNo, errorColNo;
+
+void recoverError(int lineNo, int colNo) {
+  errorLineNo = lineNo;
+  errorColNo = colNo;
+  longjmp(*errorRecovery, 1);
+}
+
 void error(ErrorCode err, int lineNo, int colNo) {
   int i;
   for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
     if (errors[i].errorCode == err) {
+      if (errorRecovery != NULL) {
+	snprintf(errorMessage, MAX_ERROR_LEN, "%s", errors[i].message);
+	recoverError(lineNo, colNo);
+      }
       printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
       exit(0);
     }
 }
 
 void missingToken(TokenType tokenType, int lineNo, int colNo) {
+  if (errorRecovery != NULL) {
+    snprintf(errorMessage, MAX_ERROR_LEN, "Missing %s", tokenToString(tokenType));
+    recoverError(lineNo, colNo);
+  }
   printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
   exit(0);
 }
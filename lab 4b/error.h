@@ -6,8 +6,11 @@
 
 #ifndef __ERROR_H__
 #define __ERROR_H__
+#include <setjmp.h>
 #include "token.h"
 
+#define MAX_ERROR_LEN 128
+
 typedef enum {
   ERR_END_OF_COMMENT,
   ERR_IDENT_TOO_LONG,
@@ -35,11 +38,18 @@ typedef enum {
   ERR_UNDECLARED_VARIABLE,
   ERR_UNDECLARED_FUNCTION,
   ERR_UNDECLARED_PROCEDURE,
+  ERR_UNDECLARED_UNIT,
   ERR_DUPLICATE_IDENT,
   ERR_TYPE_INCONSISTENCY,
   ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY
 } ErrorCode;
 
+// When it is set, as by kplc --lsp, an error is kept and jumps there 
+// instead of exiting
+extern jmp_buf* errorRecovery;
+extern char errorMessage[];
+extern int errorLineNo, errorColNo;
+
 void error(ErrorCode err, int lineNo, int colNo);
 void missingToken(TokenType tokenType, int lineNo, int colNo);
 void assert(char *msg);
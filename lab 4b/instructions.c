@@ -5,10 +5,13 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include "instructions.h"
 
 #define MAX_BLOCK 50
 
+void (*codeOverflow)(void) = NULL;
+
 CodeBlock* createCodeBlock(int maxSize) {
   CodeBlock* codeBlock = (CodeBlock*) malloc(sizeof(CodeBlock));
 
@@ -23,11 +26,31 @@ void freeCodeBlock(CodeBlock* codeBlock) {
   free(codeBlock);
 }
 
+// The block doubles until size instructions fit in it. The instructions
+// move, the code keeps their addresses.
+int growCodeBlock(CodeBlock* codeBlock, int size) {
+  Instruction* code;
+  int maxSize = codeBlock->maxSize;
+
+  if (size <= maxSize) return 1;
+  while ((maxSize < size) && (maxSize <= INT_MAX / (2 * (int) sizeof(Instruction))))
+    maxSize = (maxSize == 0) ? 1 : 2 * maxSize;
+  code = (maxSize < size) ? NULL : (Instruction*) realloc(codeBlock->code, maxSize * sizeof(Instruction));
+  if (code == NULL) {
+    if (codeOverflow != NULL) codeOverflow();
+    return 0;
+  }
+  codeBlock->code = code;
+  codeBlock->maxSize = maxSize;
+  return 1;
+}
+
 int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q) {
-  Instruction* bottom = codeBlock->code + codeBlock->codeSize;
+  Instruction* bottom;
 
-  if (codeBlock->codeSize >= codeBlock->maxSize) return 0;
+  if (!growCodeBlock(codeBlock, codeBlock->codeSize + 1)) return 0;
 
+  bottom = codeBlock->code + codeBlock->codeSize;
   bottom->op = op;
   bottom->p = p;
   bottom->q = q;
@@ -65,9 +88,145 @@ int emitGT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GT, DC_VALUE, D
 int emitLT(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LT, DC_VALUE, DC_VALUE); }
 int emitGE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_GE, DC_VALUE, DC_VALUE); }
 int emitLE(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_LE, DC_VALUE, DC_VALUE); }
+int emitBC(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_BC, DC_VALUE, q); }
+int emitFI(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_FI, DC_VALUE, q); }
+int emitFS(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_FS, DC_VALUE, q); }
+int emitJEQ(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JEQ, DC_VALUE, q); }
+int emitJNE(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JNE, DC_VALUE, q); }
+int emitJGT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JGT, DC_VALUE, q); }
+int emitJLT(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JLT, DC_VALUE, q); }
+int emitJGE(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JGE, DC_VALUE, q); }
+int emitJLE(CodeBlock* codeBlock, WORD q) { return emitCode(codeBlock, OP_JLE, DC_VALUE, q); }
 
 int emitBP(CodeBlock* codeBlock) { return emitCode(codeBlock, OP_BP, DC_VALUE, DC_VALUE); }
 
+// Instructions jumping inside the current body
+int isBranchInstruction(enum OpCode op) {
+  switch (op) {
+  case OP_J:
+  case OP_FJ:
+  case OP_FI:
+  case OP_FS:
+  case OP_JEQ:
+  case OP_JNE:
+  case OP_JGT:
+  case OP_JLT:
+  case OP_JGE:
+  case OP_JLE:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+// The jump taken when a comparison is false, FJ for any other instruction
+enum OpCode getFalseJump(enum OpCode comparison) {
+  switch (comparison) {
+  case OP_EQ: return OP_JNE;
+  case OP_NE: return OP_JEQ;
+  case OP_GT: return OP_JLE;
+  case OP_LT: return OP_JGE;
+  case OP_GE: return OP_JLT;
+  case OP_LE: return OP_JGT;
+  default: return OP_FJ;
+  }
+}
+
+// Instructions whose q operand is a code address
+int isJumpInstruction(enum OpCode op) {
+  return isBranchInstruction(op) || (op == OP_CALL);
+}
+
+
+// Change of t made by an instruction. A call returns with the base 
+// of the callee's frame on top: its return value for a function.
+int getStackEffect(Instruction* inst) {
+  switch (inst->op) {
+  case OP_LA:
+  case OP_LV:
+  case OP_LC:
+  case OP_CV:
+  case OP_RC:
+  case OP_RI:
+  case OP_CALL:
+    return 1;
+  case OP_INT: 
+    return inst->q;
+  case OP_DCT: 
+    return - inst->q;
+  case OP_FJ:
+  case OP_FI:
+  case OP_WRC:
+  case OP_WRI:
+  case OP_AD:
+  case OP_SB:
+  case OP_ML:
+  case OP_DV:
+  case OP_EQ:
+  case OP_NE:
+  case OP_GT:
+  case OP_LT:
+  case OP_GE:
+  case OP_LE:
+    return -1;
+  case OP_ST:
+  case OP_JEQ:
+  case OP_JNE:
+  case OP_JGT:
+  case OP_JLT:
+  case OP_JGE:
+  case OP_JLE:
+    return -2;
+  default:
+    return 0;
+  }
+}
+
+char* getOpCodeName(enum OpCode op) {
+  switch (op) {
+  case OP_LA: return "LA";
+  case OP_LV: return "LV";
+  case OP_LC: return "LC";
+  case OP_LI: return "LI";
+  case OP_INT: return "INT";
+  case OP_DCT: return "DCT";
+  case OP_J: return "J";
+  case OP_FJ: return "FJ";
+  case OP_HL: return "HL";
+  case OP_ST: return "ST";
+  case OP_CALL: return "CALL";
+  case OP_EP: return "EP";
+  case OP_EF: return "EF";
+  case OP_RC: return "RC";
+  case OP_RI: return "RI";
+  case OP_WRC: return "WRC";
+  case OP_WRI: return "WRI";
+  case OP_WLN: return "WLN";
+  case OP_AD: return "AD";
+  case OP_SB: return "SB";
+  case OP_ML: return "ML";
+  case OP_DV: return "DV";
+  case OP_NEG: return "NEG";
+  case OP_CV: return "CV";
+  case OP_EQ: return "EQ";
+  case OP_NE: return "NE";
+  case OP_GT: return "GT";
+  case OP_LT: return "LT";
+  case OP_GE: return "GE";
+  case OP_LE: return "LE";
+  case OP_BC: return "BC";
+  case OP_FI: return "FI";
+  case OP_FS: return "FS";
+  case OP_JEQ: return "JEQ";
+  case OP_JNE: return "JNE";
+  case OP_JGT: return "JGT";
+  case OP_JLT: return "JLT";
+  case OP_JGE: return "JGE";
+  case OP_JLE: return "JLE";
+  case OP_BP: return "BP";
+  default: return "?";
+  }
+}
 
 void printInstruction(Instruction* inst) {
   switch (inst->op) {
@@ -101,6 +260,15 @@ void printInstruction(Instruction* inst) {
   case OP_LT: printf("LT"); break;
   case OP_GE: printf("GE"); break;
   case OP_LE: printf("LE"); break;
+  case OP_BC: printf("BC %d", inst->q); break;
+  case OP_FI: printf("FI %d", inst->q); break;
+  case OP_FS: printf("FS %d", inst->q); break;
+  case OP_JEQ: printf("JEQ %d", inst->q); break;
+  case OP_JNE: printf("JNE %d", inst->q); break;
+  case OP_JGT: printf("JGT %d", inst->q); break;
+  case OP_JLT: printf("JLT %d", inst->q); break;
+  case OP_JGE: printf("JGE %d", inst->q); break;
+  case OP_JLE: printf("JLE %d", inst->q); break;
 
   case OP_BP: printf("BP"); break;
   default: break;
@@ -29,10 +29,10 @@ enum OpCode {
   OP_HL,   // Halt             Halt
   OP_ST,   // Store            s[s[t-1]] := s[t]; t := t -2;
   OP_CALL, // Call             s[t+2] := b; s[t+3] := pc; s[t+4]:= base(p); b:=t+1; pc:=q;
-  OP_EP,   // Exit Procedure   t := b - 1;  pc := s[b+2];  b := s[b+1];
+  OP_EP,   // Exit Procedure   t := b;  pc := s[b+2];  b := s[b+1];
   OP_EF,   // Exit Function    t := b;  pc := s[b+2];  b := s[b+1];
-  OP_RC,   // Read Char        read one character into s[s[t]];  t := t - 1;
-  OP_RI,   // Read Integer     read integer to s[s[t]];  t := t-1;
+  OP_RC,   // Read Char        t := t + 1;  read one character into s[t];
+  OP_RI,   // Read Integer     t := t + 1;  read integer into s[t];
   OP_WRC,  // Write Char       write one character from s[t];  t := t-1;
   OP_WRI,  // Write Int        write integer from s[t];  t := t-1;
   OP_WLN,  // WriteLN          CR/LF
@@ -49,6 +49,16 @@ enum OpCode {
   OP_GE,   // Greater or Equal t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
   OP_LE,   // Less or Equal    t := t - 1;  if s[t] >= s[t+1] then s[t] := 1 else s[t] := 0;
 
+  OP_BC,   // Bounds Check     if (s[t] < 0) or (s[t] >= q) then error;
+  OP_FI,   // For Init         s[s[t-2]] := s[t-1]; s[t-1] := s[t]; t := t-1; if s[s[t-1]] > s[t] then pc := q;
+  OP_FS,   // For Step         s[s[t-1]] := s[s[t-1]] + 1; if s[s[t-1]] <= s[t] then pc := q;
+  OP_JEQ,  // Jump if EQ       t := t - 2;  if s[t+1] = s[t+2] then pc := q;
+  OP_JNE,  // Jump if NE       t := t - 2;  if s[t+1] != s[t+2] then pc := q;
+  OP_JGT,  // Jump if GT       t := t - 2;  if s[t+1] > s[t+2] then pc := q;
+  OP_JLT,  // Jump if LT       t := t - 2;  if s[t+1] < s[t+2] then pc := q;
+  OP_JGE,  // Jump if GE       t := t - 2;  if s[t+1] >= s[t+2] then pc := q;
+  OP_JLE,  // Jump if LE       t := t - 2;  if s[t+1] <= s[t+2] then pc := q;
+
   OP_BP    // Break point. Just for debugging
 };
 
@@ -69,8 +79,12 @@ struct CodeBlock_ {
 
 typedef struct CodeBlock_ CodeBlock;
 
+// Called when a block can't grow to fit an instruction
+extern void (*codeOverflow)(void);
+
 CodeBlock* createCodeBlock(int maxSize);
 void freeCodeBlock(CodeBlock* codeBlock);
+int growCodeBlock(CodeBlock* codeBlock, int size);
 
 int emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q);
 
@@ -104,9 +118,24 @@ int emitGT(CodeBlock* codeBlock);
 int emitLT(CodeBlock* codeBlock);
 int emitGE(CodeBlock* codeBlock);
 int emitLE(CodeBlock* codeBlock);
+int emitBC(CodeBlock* codeBlock, WORD q);
+int emitFI(CodeBlock* codeBlock, WORD q);
+int emitFS(CodeBlock* codeBlock, WORD q);
+int emitJEQ(CodeBlock* codeBlock, WORD q);
+int emitJNE(CodeBlock* codeBlock, WORD q);
+int emitJGT(CodeBlock* codeBlock, WORD q);
+int emitJLT(CodeBlock* codeBlock, WORD q);
+int emitJGE(CodeBlock* codeBlock, WORD q);
+int emitJLE(CodeBlock* codeBlock, WORD q);
 
 int emitBP(CodeBlock* codeBlock);
 
+int isBranchInstruction(enum OpCode op);
+enum OpCode getFalseJump(enum OpCode comparison);
+int isJumpInstruction(enum OpCode op);
+int getStackEffect(Instruction* inst);
+
+char* getOpCodeName(enum OpCode op);
 void printInstruction(Instruction* instruction);
 void printCodeBlock(CodeBlock* codeBlock);
 
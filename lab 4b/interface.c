@@ -0,0 +1,285 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "interface.h"
+
+extern __thread SymTab* symtab;
+
+struct InterfaceHeader_ {
+  int magic;
+  int recordCount;
+};
+
+typedef struct InterfaceHeader_ InterfaceHeader;
+
+// The records of a mapped interface file, read in order
+struct InterfaceReader_ {
+  InterfaceRecord* records;
+  int recordCount;
+  int nextRecord;
+};
+
+typedef struct InterfaceReader_ InterfaceReader;
+
+// The interface is used if it was saved after the last change of the
+// source, or if there is no source
+int isInterfaceUpToDate(char* interfaceName, char* sourceName) {
+  struct stat interfaceStat;
+  struct stat sourceStat;
+
+  if (stat(interfaceName, &interfaceStat) != 0) return 0;
+  if (stat(sourceName, &sourceStat) != 0) return 1;
+  if (interfaceStat.st_mtim.tv_sec != sourceStat.st_mtim.tv_sec)
+    return interfaceStat.st_mtim.tv_sec > sourceStat.st_mtim.tv_sec;
+  return interfaceStat.st_mtim.tv_nsec >= sourceStat.st_mtim.tv_nsec;
+}
+
+/******************* Saving ******************************/
+
+void writeRecord(FILE* f, enum RecordKind kind, char* name, int value, int typeClass) {
+  InterfaceRecord record;
+
+  memset(&record, 0, sizeof(InterfaceRecord));
+  record.kind = kind;
+  if (name != NULL) 
+    strncpy(record.name, name, MAX_IDENT_LEN);
+  record.value = value;
+  record.typeClass = typeClass;
+  fwrite(&record, sizeof(InterfaceRecord), 1, f);
+}
+
+void writeType(FILE* f, Type* type) {
+  for (; type->typeClass == TP_ARRAY; type = type->elementType)
+    writeRecord(f, RECORD_ARRAY_TYPE, NULL, type->arraySize, TP_ARRAY);
+  writeRecord(f, RECORD_BASIC_TYPE, NULL, 0, type->typeClass);
+}
+
+void writeParams(FILE* f, ObjectNode* paramList) {
+  for (; paramList != NULL; paramList = paramList->next) {
+    writeRecord(f, RECORD_PARAMETER, paramList->object->name, paramList->object->paramAttrs->kind, 0);
+    writeType(f, paramList->object->paramAttrs->type);
+  }
+}
+
+// The units used by the unit, then its constants, types and subprograms
+int saveInterface(char* fileName, Object* unit, char usedUnits[][MAX_IDENT_LEN + 1], int unitCount) {
+  InterfaceHeader header;
+  ConstantValue* value;
+  ObjectNode* node;
+  Object* obj;
+  FILE* f;
+  int i;
+
+  f = fopen(fileName, "wb");
+  if (f == NULL) return IO_ERROR;
+
+  header.magic = INTERFACE_MAGIC;
+  header.recordCount = 0;
+  fwrite(&header, sizeof(InterfaceHeader), 1, f);
+
+  for (i = 0; i < unitCount; i ++)
+    writeRecord(f, RECORD_USES, usedUnits[i], 0, 0);
+
+  for (node = unit->progAttrs->scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    switch (obj->kind) {
+    case OBJ_CONSTANT:
+      value = obj->constAttrs->value;
+      writeRecord(f, RECORD_CONSTANT, obj->name, 
+		  (value->type == TP_INT) ? value->intValue : value->charValue, value->type);
+      break;
+    case OBJ_TYPE:
+      writeRecord(f, RECORD_TYPE, obj->name, 0, 0);
+      writeType(f, obj->typeAttrs->actualType);
+      break;
+    case OBJ_FUNCTION:
+      writeRecord(f, RECORD_FUNCTION, obj->name, obj->funcAttrs->paramCount, 0);
+      writeParams(f, obj->funcAttrs->paramList);
+      writeType(f, obj->funcAttrs->returnType);
+      break;
+    case OBJ_PROCEDURE:
+      writeRecord(f, RECORD_PROCEDURE, obj->name, obj->procAttrs->paramCount, 0);
+      writeParams(f, obj->procAttrs->paramList);
+      break;
+    default:
+      break;
+    }
+  }
+
+  header.recordCount = (ftell(f) - sizeof(InterfaceHeader)) / sizeof(InterfaceRecord);
+  fseek(f, 0, SEEK_SET);
+  fwrite(&header, sizeof(InterfaceHeader), 1, f);
+  fclose(f);
+  return IO_SUCCESS;
+}
+
+/******************* Loading ******************************/
+
+// NULL at the end of the records, or for a name too long
+InterfaceRecord* readRecord(InterfaceReader* reader) {
+  InterfaceRecord* record;
+
+  if (reader->nextRecord >= reader->recordCount) return NULL;
+  record = reader->records + reader->nextRecord ++;
+  if (memchr(record->name, '\0', MAX_IDENT_LEN + 1) == NULL) return NULL;
+  return record;
+}
+
+Type* readType(InterfaceReader* reader) {
+  InterfaceRecord* record = readRecord(reader);
+  Type* elementType;
+
+  if (record == NULL) return NULL;
+  if (record->kind == RECORD_ARRAY_TYPE) {
+    elementType = readType(reader);
+    return (elementType == NULL) ? NULL : makeArrayType(record->value, elementType);
+  }
+
+  if (record->kind != RECORD_BASIC_TYPE) return NULL;
+  if (record->typeClass == TP_INT) return makeIntType();
+  if (record->typeClass == TP_CHAR) return makeCharType();
+  return NULL;
+}
+
+// In the scope of the subprogram
+int readParams(InterfaceReader* reader, int paramCount) {
+  InterfaceRecord* record;
+  Object* param;
+  Type* type;
+  int i;
+
+  for (i = 0; i < paramCount; i ++) {
+    record = readRecord(reader);
+    if ((record == NULL) || (record->kind != RECORD_PARAMETER) || 
+	((record->value != PARAM_VALUE) && (record->value != PARAM_REFERENCE)))
+      return 0;
+
+    type = readType(reader);
+    if (type == NULL) return 0;
+    param = createParameterObject(record->name, record->value);
+    param->paramAttrs->type = type;
+    declareObject(param);
+  }
+  return 1;
+}
+
+int readObject(InterfaceReader* reader) {
+  InterfaceRecord* record = readRecord(reader);
+  Object* obj;
+  Type* type;
+  int valid;
+
+  if (record == NULL) return 0;
+  switch (record->kind) {
+  case RECORD_CONSTANT:
+    if ((record->typeClass != TP_INT) && (record->typeClass != TP_CHAR)) return 0;
+    obj = createConstantObject(record->name);
+    if (record->typeClass == TP_INT)
+      obj->constAttrs->value = makeIntConstant(record->value);
+    else obj->constAttrs->value = makeCharConstant(record->value);
+    declareObject(obj);
+    return 1;
+  case RECORD_TYPE:
+    type = readType(reader);
+    if (type == NULL) return 0;
+    obj = createTypeObject(record->name);
+    obj->typeAttrs->actualType = type;
+    declareObject(obj);
+    return 1;
+  case RECORD_FUNCTION:
+    obj = createFunctionObject(record->name);
+    obj->funcAttrs->returnType = makeIntType();
+    declareObject(obj);
+    enterBlock(obj->funcAttrs->scope);
+    valid = readParams(reader, record->value);
+    exitBlock();
+    if (!valid || ((type = readType(reader)) == NULL)) return 0;
+    freeType(obj->funcAttrs->returnType);
+    obj->funcAttrs->returnType = type;
+    return 1;
+  case RECORD_PROCEDURE:
+    obj = createProcedureObject(record->name);
+    declareObject(obj);
+    enterBlock(obj->procAttrs->scope);
+    valid = readParams(reader, record->value);
+    exitBlock();
+    return valid;
+  default:
+    return 0;
+  }
+}
+
+// The units it uses are imported first, as by its source. NULL if the
+// records are not valid.
+Object* readInterface(InterfaceReader* reader) {
+  Object* savedProgram = symtab->program;
+  Scope* savedScope = symtab->currentScope;
+  InterfaceRecord* record;
+  Object* unit;
+  int valid = 1;
+
+  while ((reader->nextRecord < reader->recordCount) && 
+	 (reader->records[reader->nextRecord].kind == RECORD_USES)) {
+    record = readRecord(reader);
+    if (record == NULL) return NULL;
+    importUnit(record->name);
+  }
+
+  unit = createProgramObject("");
+  enterBlock(unit->progAttrs->scope);
+  while (valid && (reader->nextRecord < reader->recordCount))
+    valid = readObject(reader);
+  symtab->program = savedProgram;
+  symtab->currentScope = savedScope;
+
+  if (!valid) {
+    freeObject(unit);
+    return NULL;
+  }
+  return unit;
+}
+
+// The declarations of a unit, in the scope of an unnamed unit object. 
+// NULL if the file is not a valid interface.
+Object* loadInterface(char* fileName) {
+  InterfaceHeader* header;
+  InterfaceReader reader;
+  struct stat fileStat;
+  Object* unit = NULL;
+  void* map;
+  int fd;
+
+  fd = open(fileName, O_RDONLY);
+  if (fd < 0) return NULL;
+  if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size < sizeof(InterfaceHeader))) {
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return NULL;
+
+  header = (InterfaceHeader*) map;
+  reader.records = (InterfaceRecord*) (header + 1);
+  reader.recordCount = header->recordCount;
+  reader.nextRecord = 0;
+  if ((header->magic == INTERFACE_MAGIC) && (reader.recordCount >= 0) &&
+      (fileStat.st_size == sizeof(InterfaceHeader) + (size_t) reader.recordCount * sizeof(InterfaceRecord)))
+    unit = readInterface(&reader);
+
+  munmap(map, fileStat.st_size);
+  return unit;
+}
@@ -0,0 +1,42 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INTERFACE_H__
+#define __INTERFACE_H__
+
+#include "symtab.h"
+
+// "KPLI" at the start of an interface file
+#define INTERFACE_MAGIC 0x494C504B
+
+enum RecordKind {
+  RECORD_USES,
+  RECORD_CONSTANT,
+  RECORD_TYPE,
+  RECORD_FUNCTION,
+  RECORD_PROCEDURE,
+  RECORD_PARAMETER,
+  RECORD_BASIC_TYPE,
+  RECORD_ARRAY_TYPE
+};
+
+// The declarations of a unit, in records of the same size. A type is
+// a record per level of arrays. A function is followed by its parameters,
+// each followed by its type, then by its return type.
+struct InterfaceRecord_ {
+  enum RecordKind kind;
+  char name[MAX_IDENT_LEN + 1];
+  int value;   // a constant, a number of parameters, a parameter kind or an array size
+  int typeClass;
+};
+
+typedef struct InterfaceRecord_ InterfaceRecord;
+
+int isInterfaceUpToDate(char* interfaceName, char* sourceName);
+int saveInterface(char* fileName, Object* unit, char usedUnits[][MAX_IDENT_LEN + 1], int unitCount);
+Object* loadInterface(char* fileName);
+
+#endif
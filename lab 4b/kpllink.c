@@ -0,0 +1,88 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "reader.h"
+#include "linker.h"
+
+void printUsage(void) {
+  printf("Usage: kpllink output program unit...\n");
+  printf("   output: executable\n");
+  printf("   program: object of the program generated by kplc\n");
+  printf("   unit: objects of the units it uses\n");
+}
+
+ObjectCode* loadObjectFile(char* fileName) {
+  ObjectCode* object;
+  FILE* f;
+
+  f = fopen(fileName, "rb");
+  if (f == NULL) {
+    printf("Can\'t read input file %s!\n", fileName);
+    return NULL;
+  }
+  object = loadObjectCode(f);
+  fclose(f);
+  if (object == NULL)
+    printf("kpllink: %s is not an object generated by kplc.\n", fileName);
+  return object;
+}
+
+int saveExecutable(CodeBlock* codeBlock, char* fileName) {
+  FILE* f;
+
+  f = fopen(fileName, "wb");
+  if (f == NULL) return IO_ERROR;
+  saveCode(codeBlock, f);
+  fclose(f);
+  return IO_SUCCESS;
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  ObjectCode** objects;
+  CodeBlock* codeBlock = NULL;
+  int count = 0;
+  int i;
+
+  if (argc <= 2) {
+    printf("kpllink: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  objects = (ObjectCode**) malloc((argc - 2) * sizeof(ObjectCode*));
+  for (i = 2; i < argc; i ++) {
+    objects[count] = loadObjectFile(argv[i]);
+    if (objects[count] == NULL) break;
+
+    if (objects[count]->isUnit != (i > 2)) {
+      printf("kpllink: %s must be %s.\n", argv[i], (i > 2) ? "a unit" : "the program");
+      freeObjectCode(objects[count]);
+      break;
+    }
+    count ++;
+  }
+
+  if (count == argc - 2) 
+    codeBlock = linkObjects(objects, count);
+
+  for (i = 0; i < count; i ++)
+    freeObjectCode(objects[i]);
+  free(objects);
+  if (codeBlock == NULL) return -1;
+
+  if (saveExecutable(codeBlock, argv[1]) == IO_ERROR) {
+    printf("Can\'t write output file!\n");
+    freeCodeBlock(codeBlock);
+    return -1;
+  }
+  freeCodeBlock(codeBlock);
+  return 0;
+}
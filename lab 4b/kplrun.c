@@ -0,0 +1,118 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "reader.h"
+#include "vm.h"
+#include "profiler.h"
+#include "verifier.h"
+
+extern CodeBlock* codeBlock;
+
+int profile = 0;
+int stackWords = DEFAULT_STACK_SIZE;
+
+void printUsage(void) {
+  printf("Usage: kplrun input [--profile] [--stack=words]\n");
+  printf("   input: executable generated by kplc\n");
+  printf("   --profile: report the executed instructions on stderr,\n");
+  printf("              and save the call stacks to input.folded\n");
+  printf("   --stack=words: size of the stack, %d words by default, at most %d\n", 
+	 DEFAULT_STACK_SIZE, MAX_STACK_SIZE);
+}
+
+int analyseParam(char* param) {
+  char* end;
+  long words;
+
+  if (strcmp(param, "--profile") == 0) {
+    profile = 1;
+    return 1;
+  } else if (strncmp(param, "--stack=", 8) == 0) {
+    errno = 0;
+    words = strtol(param + 8, &end, 10);
+    if ((errno == ERANGE) || (end == param + 8) || (*end != '\0') || 
+	(words <= 0) || (words > MAX_STACK_SIZE))
+      return 0;
+    stackWords = (int) words;
+    return 1;
+  }
+  return 0;
+}
+
+// Call stacks in the folded format of flame graphs
+int saveProfile(char* input) {
+  char* fileName = (char*) malloc(strlen(input) + 8);
+  int success;
+
+  sprintf(fileName, "%s.folded", input);
+  printProfile(stderr);
+  success = saveFoldedStacks(fileName);
+  free(fileName);
+  return success;
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int state;
+  int i;
+
+  if (argc <= 1) {
+    printf("kplrun: no input file.\n");
+    printUsage();
+    return -1;
+  }
+
+  for (i = 2; i < argc; i ++) 
+    if (!analyseParam(argv[i])) {
+      printf("kplrun: invalid option %s.\n", argv[i]);
+      printUsage();
+      return -1;
+    }
+
+  if (loadExecutable(argv[1]) == IO_ERROR) {
+    printf("Can\'t read input file!\n");
+    return -1;
+  }
+
+  state = verifyCode(codeBlock, stackWords);
+  if (state != VS_VALID) {
+    printf("Invalid executable at %d: %s\n", getVerifierErrorAddress(), verifierErrorMessage(state));
+    cleanVerifier();
+    cleanVM();
+    return -1;
+  }
+
+  if (!initVM(stackWords)) {
+    printf("Can\'t allocate the stack!\n");
+    return -1;
+  }
+
+  if (profile && !initProfiler(codeBlock)) {
+    printf("Can\'t allocate the profiler!\n");
+    return -1;
+  }
+
+  state = run();
+  fflush(stdout);
+  if (state != PS_SUCCESS)
+    printf("Runtime error at %d: %s\n", getProgramCounter(), runtimeErrorMessage(state));
+
+  if (profile) {
+    if (!saveProfile(argv[1]))
+      printf("Can\'t write the call stacks!\n");
+    cleanProfiler();
+  }
+
+  cleanVerifier();
+  cleanVM();
+  return (state == PS_SUCCESS) ? 0 : -1;
+}
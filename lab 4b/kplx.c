@@ -0,0 +1,287 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "reader.h"
+#include "xref.h"
+
+typedef char SourceName[MAX_SOURCE_NAME];
+
+// An index file mapped in memory
+struct MappedIndex_ {
+  XrefHeader* header;
+  SourceName* sources;
+  XrefRecord* records;
+  size_t size;
+};
+
+typedef struct MappedIndex_ MappedIndex;
+
+char* kindNames[] = {"constant", "variable", "type", "function", "procedure", "parameter", "program"};
+
+// kplx refs: the name searched, in upper case as the compiler keeps it
+char searchedName[MAX_IDENT_LEN + 1];
+int foundCount = 0;
+
+// kplx merge: the sources and the records of the indexes read
+SourceName* mergedSources = NULL;
+int mergedSourceCount = 0;
+XrefRecord* mergedRecords = NULL;
+int mergedRecordCount = 0;
+int maxMergedRecordCount = 0;
+struct stat outputStat;
+int outputExists = 0;
+
+void printUsage(void) {
+  printf("Usage: kplx refs name [index|directory]...\n");
+  printf("       kplx merge output [index|directory]...\n");
+  printf("   refs: print the definitions and uses of name\n");
+  printf("   merge: save in output the index of all the sources, searched at once\n");
+  printf("   index: file.kpx saved by kplc -xref, or an index saved by kplx merge\n");
+  printf("   directory: its .kpx files and those of its subdirectories, the current\n");
+  printf("              directory by default\n");
+}
+
+// 0 if the file is not a valid index
+int mapIndex(char* fileName, MappedIndex* index) {
+  struct stat fileStat;
+  XrefHeader* header;
+  void* map;
+  int fd, i;
+
+  fd = open(fileName, O_RDONLY);
+  if (fd < 0) {
+    printf("Can\'t read index file %s!\n", fileName);
+    return 0;
+  }
+  if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size < sizeof(XrefHeader))) {
+    printf("kplx: %s is not an index saved by kplc -xref.\n", fileName);
+    close(fd);
+    return 0;
+  }
+  map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("Can\'t read index file %s!\n", fileName);
+    return 0;
+  }
+
+  header = (XrefHeader*) map;
+  if ((header->magic == XREF_MAGIC) && (header->sourceCount >= 0) && (header->recordCount >= 0) &&
+      (fileStat.st_size == sizeof(XrefHeader) + (size_t) header->sourceCount * sizeof(SourceName) +
+       (size_t) header->recordCount * sizeof(XrefRecord))) {
+    index->header = header;
+    index->sources = (SourceName*) (header + 1);
+    index->records = (XrefRecord*) (index->sources + header->sourceCount);
+    index->size = fileStat.st_size;
+    for (i = 0; i < header->sourceCount; i ++)
+      if (memchr(index->sources[i], '\0', MAX_SOURCE_NAME) == NULL) break;
+    if (i == header->sourceCount) return 1;
+  }
+
+  printf("kplx: %s is not an index saved by kplc -xref.\n", fileName);
+  munmap(map, fileStat.st_size);
+  return 0;
+}
+
+void unmapIndex(MappedIndex* index) {
+  munmap(index->header, index->size);
+}
+
+// Its directories are searched for .kpx files, in the order of the names.
+// The links to directories found in them are not followed, as they may
+// lead back to a parent.
+void forEachIndex(char* fileName, void (*visit)(char* fileName)) {
+  struct dirent** entries;
+  struct stat fileStat;
+  char* path;
+  int count, length, i;
+
+  if ((stat(fileName, &fileStat) != 0) || !S_ISDIR(fileStat.st_mode)) {
+    visit(fileName);
+    return;
+  }
+
+  count = scandir(fileName, &entries, NULL, alphasort);
+  if (count < 0) {
+    printf("Can\'t read directory %s!\n", fileName);
+    return;
+  }
+  for (i = 0; i < count; i ++) {
+    if (entries[i]->d_name[0] != '.') {
+      path = (char*) malloc(strlen(fileName) + strlen(entries[i]->d_name) + 2);
+      sprintf(path, "%s/%s", fileName, entries[i]->d_name);
+      length = strlen(path);
+      if (lstat(path, &fileStat) == 0) {
+	if (S_ISDIR(fileStat.st_mode))
+	  forEachIndex(path, visit);
+	else if ((length > 4) && (strcmp(path + length - 4, ".kpx") == 0) &&
+		 (stat(path, &fileStat) == 0) && !S_ISDIR(fileStat.st_mode))
+	  visit(path);
+      }
+      free(path);
+    }
+    free(entries[i]);
+  }
+  free(entries);
+}
+
+/******************* kplx refs ******************************/
+
+void printRecord(MappedIndex* index, XrefRecord* record) {
+  if ((record->source >= 0) && (record->source < index->header->sourceCount))
+    printf("%s:", index->sources[record->source]);
+  printf("%d:%d: %s of ", record->lineNo, record->colNo,
+	 (record->use == XREF_DEFINITION) ? "definition" : "use");
+  if ((record->kind >= OBJ_CONSTANT) && (record->kind <= OBJ_PROGRAM))
+    printf("%s ", kindNames[record->kind]);
+  printf("%.*s", MAX_IDENT_LEN + 1, record->name);
+  if (record->scope[0] != '\0')
+    printf(" in %.*s", MAX_IDENT_LEN + 1, record->scope);
+  printf("\n");
+}
+
+// The records of the name are found by a binary search
+void searchIndex(char* fileName) {
+  MappedIndex index;
+  int recordCount, low, high, middle;
+
+  if (!mapIndex(fileName, &index)) return;
+
+  // The first record not before the name
+  recordCount = index.header->recordCount;
+  low = 0;
+  high = recordCount;
+  while (low < high) {
+    middle = (low + high) / 2;
+    if (strncmp(index.records[middle].name, searchedName, MAX_IDENT_LEN + 1) < 0)
+      low = middle + 1;
+    else high = middle;
+  }
+  for (; (low < recordCount) &&
+	 (strncmp(index.records[low].name, searchedName, MAX_IDENT_LEN + 1) == 0); low ++) {
+    printRecord(&index, index.records + low);
+    foundCount ++;
+  }
+
+  unmapIndex(&index);
+}
+
+/******************* kplx merge ******************************/
+
+// Its sources follow those read, the output is not read again
+void mergeIndex(char* fileName) {
+  MappedIndex index;
+  struct stat fileStat;
+  XrefRecord* record;
+  int i;
+
+  if (outputExists && (stat(fileName, &fileStat) == 0) &&
+      (fileStat.st_dev == outputStat.st_dev) && (fileStat.st_ino == outputStat.st_ino))
+    return;
+  if (!mapIndex(fileName, &index)) return;
+
+  if (index.header->sourceCount > 0) {
+    mergedSources = (SourceName*) realloc(mergedSources, (mergedSourceCount + index.header->sourceCount) * sizeof(SourceName));
+    memcpy(mergedSources + mergedSourceCount, index.sources, index.header->sourceCount * sizeof(SourceName));
+  }
+
+  for (i = 0; i < index.header->recordCount; i ++) {
+    if ((index.records[i].source < 0) || (index.records[i].source >= index.header->sourceCount))
+      continue;
+    if (mergedRecordCount == maxMergedRecordCount) {
+      maxMergedRecordCount = (maxMergedRecordCount == 0) ? 4096 : 2 * maxMergedRecordCount;
+      mergedRecords = (XrefRecord*) realloc(mergedRecords, maxMergedRecordCount * sizeof(XrefRecord));
+    }
+    record = mergedRecords + mergedRecordCount ++;
+    *record = index.records[i];
+    record->name[MAX_IDENT_LEN] = '\0';
+    record->source += mergedSourceCount;
+  }
+  mergedSourceCount += index.header->sourceCount;
+
+  unmapIndex(&index);
+}
+
+int compareMergedRecords(const void* a, const void* b) {
+  const XrefRecord* record1 = (const XrefRecord*) a;
+  const XrefRecord* record2 = (const XrefRecord*) b;
+  int result = strcmp(record1->name, record2->name);
+
+  if (result != 0) return result;
+  if (record1->source != record2->source)
+    return record1->source - record2->source;
+  if (record1->lineNo != record2->lineNo)
+    return record1->lineNo - record2->lineNo;
+  return record1->colNo - record2->colNo;
+}
+
+int saveMergedIndex(char* fileName) {
+  XrefHeader header;
+  FILE* f;
+
+  f = fopen(fileName, "wb");
+  if (f == NULL) return IO_ERROR;
+
+  if (mergedRecordCount > 0)
+    qsort(mergedRecords, mergedRecordCount, sizeof(XrefRecord), compareMergedRecords);
+
+  header.magic = XREF_MAGIC;
+  header.sourceCount = mergedSourceCount;
+  header.recordCount = mergedRecordCount;
+  fwrite(&header, sizeof(XrefHeader), 1, f);
+  fwrite(mergedSources, sizeof(SourceName), mergedSourceCount, f);
+  fwrite(mergedRecords, sizeof(XrefRecord), mergedRecordCount, f);
+  fclose(f);
+  return IO_SUCCESS;
+}
+
+/******************************************************************/
+
+int main(int argc, char *argv[]) {
+  int i;
+
+  if ((argc > 2) && (strcmp(argv[1], "refs") == 0)) {
+    for (i = 0; (i < MAX_IDENT_LEN) && (argv[2][i] != '\0'); i ++)
+      searchedName[i] = toupper(argv[2][i]);
+    searchedName[i] = '\0';
+
+    if (argc == 3)
+      forEachIndex(".", searchIndex);
+    for (i = 3; i < argc; i ++)
+      forEachIndex(argv[i], searchIndex);
+
+    // 0 if the name is found, as grep
+    return (foundCount > 0) ? 0 : 1;
+  }
+
+  if ((argc > 2) && (strcmp(argv[1], "merge") == 0)) {
+    outputExists = (stat(argv[2], &outputStat) == 0);
+    if (argc == 3)
+      forEachIndex(".", mergeIndex);
+    for (i = 3; i < argc; i ++)
+      forEachIndex(argv[i], mergeIndex);
+
+    if (saveMergedIndex(argv[2]) == IO_ERROR) {
+      printf("Can\'t write output file!\n");
+      return -1;
+    }
+    printf("%d sources, %d records\n", mergedSourceCount, mergedRecordCount);
+    return 0;
+  }
+
+  printUsage();
+  return -1;
+}
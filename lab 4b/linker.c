@@ -0,0 +1,149 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "linker.h"
+
+struct ObjectHeader_ {
+  int magic;
+  int isUnit;
+  int codeSize;
+  int exportCount;
+  int callCount;
+};
+
+typedef struct ObjectHeader_ ObjectHeader;
+
+void saveObjectCode(ObjectCode* object, FILE* f) {
+  ObjectHeader header;
+
+  header.magic = OBJECT_MAGIC;
+  header.isUnit = object->isUnit;
+  header.codeSize = object->codeBlock->codeSize;
+  header.exportCount = object->exportCount;
+  header.callCount = object->callCount;
+
+  fwrite(&header, sizeof(ObjectHeader), 1, f);
+  saveCode(object->codeBlock, f);
+  fwrite(object->exports, sizeof(Symbol), object->exportCount, f);
+  fwrite(object->calls, sizeof(Symbol), object->callCount, f);
+}
+
+// NULL if the file is not a complete object
+ObjectCode* loadObjectCode(FILE* f) {
+  ObjectHeader header;
+  ObjectCode* object;
+  CodeBlock* codeBlock;
+  int i;
+
+  if ((fread(&header, sizeof(ObjectHeader), 1, f) != 1) || (header.magic != OBJECT_MAGIC) ||
+      (header.codeSize < 0) || (header.exportCount < 0) || (header.callCount < 0))
+    return NULL;
+
+  codeBlock = createCodeBlock(header.codeSize + 1);
+  codeBlock->codeSize = fread(codeBlock->code, sizeof(Instruction), header.codeSize, f);
+
+  object = (ObjectCode*) malloc(sizeof(ObjectCode));
+  object->isUnit = header.isUnit;
+  object->codeBlock = codeBlock;
+  object->exports = (Symbol*) malloc((header.exportCount + 1) * sizeof(Symbol));
+  object->exportCount = fread(object->exports, sizeof(Symbol), header.exportCount, f);
+  object->calls = (Symbol*) malloc((header.callCount + 1) * sizeof(Symbol));
+  object->callCount = fread(object->calls, sizeof(Symbol), header.callCount, f);
+
+  if ((codeBlock->codeSize != header.codeSize) || (object->exportCount != header.exportCount) ||
+      (object->callCount != header.callCount)) {
+    freeObjectCode(object);
+    return NULL;
+  }
+
+  for (i = 0; i < object->callCount; i ++)
+    if ((object->calls[i].address < 0) || (object->calls[i].address >= codeBlock->codeSize)) {
+      freeObjectCode(object);
+      return NULL;
+    }
+  return object;
+}
+
+void freeObjectCode(ObjectCode* object) {
+  freeCodeBlock(object->codeBlock);
+  free(object->exports);
+  free(object->calls);
+  free(object);
+}
+
+Symbol* findSymbol(Symbol* symbols, int count, char* name) {
+  int i;
+
+  for (i = 0; i < count; i ++)
+    if (strcmp(symbols[i].name, name) == 0)
+      return symbols + i;
+  return NULL;
+}
+
+// The program first, where the execution starts, then the units. The 
+// calls of other units go to the subprograms they export.
+CodeBlock* linkObjects(ObjectCode** objects, int count) {
+  CodeBlock* codeBlock;
+  Symbol* exports;
+  Symbol* symbol;
+  Instruction* inst;
+  CodeAddress base = 0;
+  int exportCount = 0;
+  int codeSize = 0;
+  int i, j;
+
+  for (i = 0; i < count; i ++) {
+    codeSize += objects[i]->codeBlock->codeSize;
+    exportCount += objects[i]->exportCount;
+  }
+  codeBlock = createCodeBlock(codeSize + 1);
+  exports = (Symbol*) malloc((exportCount + 1) * sizeof(Symbol));
+  exportCount = 0;
+
+  for (i = 0; i < count; i ++) {
+    for (j = 0; j < objects[i]->codeBlock->codeSize; j ++) {
+      inst = objects[i]->codeBlock->code + j;
+      if (isJumpInstruction(inst->op) && (inst->q >= 0))
+	emitCode(codeBlock, inst->op, inst->p, inst->q + base);
+      else emitCode(codeBlock, inst->op, inst->p, inst->q);
+    }
+
+    for (j = 0; j < objects[i]->exportCount; j ++) {
+      symbol = objects[i]->exports + j;
+      if (findSymbol(exports, exportCount, symbol->name) != NULL) {
+	printf("kpllink: %s is exported by two units.\n", symbol->name);
+	free(exports);
+	freeCodeBlock(codeBlock);
+	return NULL;
+      }
+      exports[exportCount] = *symbol;
+      exports[exportCount].address += base;
+      exportCount ++;
+    }
+    base += objects[i]->codeBlock->codeSize;
+  }
+
+  base = 0;
+  for (i = 0; i < count; i ++) {
+    for (j = 0; j < objects[i]->callCount; j ++) {
+      symbol = findSymbol(exports, exportCount, objects[i]->calls[j].name);
+      if (symbol == NULL) {
+	printf("kpllink: undefined subprogram %s.\n", objects[i]->calls[j].name);
+	free(exports);
+	freeCodeBlock(codeBlock);
+	return NULL;
+      }
+      codeBlock->code[objects[i]->calls[j].address + base].q = symbol->address;
+    }
+    base += objects[i]->codeBlock->codeSize;
+  }
+
+  free(exports);
+  return codeBlock;
+}
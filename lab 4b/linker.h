@@ -0,0 +1,45 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __LINKER_H__
+#define __LINKER_H__
+
+#include "token.h"
+#include "instructions.h"
+
+// "KPLO" at the start of an object file
+#define OBJECT_MAGIC 0x4F4C504B
+
+// A subprogram exported at an address, or a call of a subprogram of 
+// another unit at an address
+struct Symbol_ {
+  char name[MAX_IDENT_LEN + 1];
+  CodeAddress address;
+};
+
+typedef struct Symbol_ Symbol;
+
+// The code of a program or a unit, to be linked. Its own jumps and calls 
+// are relative to its start. A call of another unit calls a negative 
+// address until it is linked.
+struct ObjectCode_ {
+  int isUnit;
+  CodeBlock* codeBlock;
+  Symbol* exports;
+  int exportCount;
+  Symbol* calls;
+  int callCount;
+};
+
+typedef struct ObjectCode_ ObjectCode;
+
+void saveObjectCode(ObjectCode* object, FILE* f);
+ObjectCode* loadObjectCode(FILE* f);
+void freeObjectCode(ObjectCode* object);
+
+CodeBlock* linkObjects(ObjectCode** objects, int count);
+
+#endif
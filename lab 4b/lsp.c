@@ -0,0 +1,1178 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <setjmp.h>
+
+#include "reader.h"
+#include "scanner.h"
+#include "parser.h"
+#include "astparser.h"
+#include "semantics.h"
+#include "ast.h"
+#include "lsp.h"
+
+// kplc --lsp: a language server on the standard input and output. Each
+// open document keeps its tokens and its symbol table. After a change,
+// the tokens are scanned again from the token before it until they are
+// the old ones again, and only the subprogram around the change is parsed
+// again, if its header is unchanged.
+
+extern Token *currentToken;
+extern Token *lookAhead;
+extern Token* (*readToken)(void);
+
+extern __thread SymTab* symtab;
+extern Type* intType;
+extern Type* charType;
+extern char* sourceFileName;
+extern int usedUnitCount;
+extern int externalCount;
+
+Document* documents[MAX_DOCUMENTS];
+int documentCount = 0;
+
+/******************************************************************/
+
+void* growArray(void* array, int* maxCount, int count, int size) {
+  if (count < *maxCount) return array;
+  *maxCount = (*maxCount == 0) ? 64 : *maxCount * 2;
+  if (*maxCount <= count) *maxCount = count + 1;
+  array = realloc(array, *maxCount * size);
+  if (array == NULL) {
+    printf("Out of memory for the documents!\n");
+    exit(-1);
+  }
+  return array;
+}
+
+void findLines(Document* doc) {
+  int i;
+
+  doc->lineCount = 0;
+  doc->lineStarts = growArray(doc->lineStarts, &doc->maxLineCount, 0, sizeof(int));
+  doc->lineStarts[doc->lineCount ++] = 0;
+  for (i = 0; i < doc->length; i ++)
+    if (doc->text[i] == '\n') {
+      doc->lineStarts = growArray(doc->lineStarts, &doc->maxLineCount, doc->lineCount, sizeof(int));
+      doc->lineStarts[doc->lineCount ++] = i + 1;
+    }
+}
+
+// line and column from 1, as the reader counts them
+void getPosition(Document* doc, int offset, int* line, int* col) {
+  int low = 0;
+  int high = doc->lineCount - 1;
+  int middle;
+
+  while (low < high) {
+    middle = (low + high + 1) / 2;
+    if (doc->lineStarts[middle] <= offset) low = middle;
+    else high = middle - 1;
+  }
+  *line = low + 1;
+  *col = offset - doc->lineStarts[low] + 1;
+}
+
+int getOffset(Document* doc, int line, int col) {
+  int offset;
+
+  if (line < 1) return 0;
+  if (line > doc->lineCount) return doc->length;
+  offset = doc->lineStarts[line - 1] + col - 1;
+  if (offset < doc->lineStarts[line - 1]) offset = doc->lineStarts[line - 1];
+  if (offset > doc->length) offset = doc->length;
+  return offset;
+}
+
+void replaceText(Document* doc, int start, int end, char* text) {
+  int length = strlen(text);
+  int newLength = doc->length - (end - start) + length;
+
+  doc->text = growArray(doc->text, &doc->maxLength, newLength + 1, 1);
+  memmove(doc->text + start + length, doc->text + end, doc->length - end + 1);
+  memcpy(doc->text + start, text, length);
+  doc->length = newLength;
+  findLines(doc);
+}
+
+/******************************************************************/
+
+FILE* lexStream;
+int lexBase;
+
+// Scan the text from offset, where no token is cut
+void startLexer(Document* doc, int offset) {
+  InputPosition position;
+
+  lexBase = offset;
+  lexStream = NULL;
+  getPosition(doc, offset, &position.lineNo, &position.colNo);
+  position.colNo --;
+  position.currentChar = EOF;
+  if (offset < doc->length)
+    lexStream = fmemopen(doc->text + offset, doc->length - offset, "r");
+  position.stream = lexStream;
+  restoreInputStream(&position);
+  if (lexStream != NULL) readChar();
+}
+
+void stopLexer(void) {
+  if (lexStream != NULL) fclose(lexStream);
+  lexStream = NULL;
+}
+
+void lexToken(Document* doc, LspToken* token) {
+  Token* t = getValidToken();
+  extern int currentChar;
+
+  token->tokenType = t->tokenType;
+  memcpy(token->string, t->string, MAX_IDENT_LEN + 1);
+  token->value = t->value;
+  if (t->tokenType == TK_EOF) {
+    token->start = doc->length;
+    token->end = doc->length;
+  } else {
+    token->start = getOffset(doc, t->lineNo, t->colNo);
+    token->end = (currentChar == EOF) ? doc->length : lexBase + ftell(lexStream) - 1;
+  }
+  free(t);
+}
+
+void addToken(LspToken** tokens, int* count, int* maxCount, LspToken* token) {
+  *tokens = growArray(*tokens, maxCount, *count, sizeof(LspToken));
+  (*tokens)[(*count) ++] = *token;
+}
+
+// The tokens from the token restart are scanned again, from the end of
+// the token before it, after the text changed from start to end, now
+// start to newEnd. They are the old ones
+// again from a token starting after the change where an old token moved.
+// Returns the index of the first old token kept, scanned contains the
+// new tokens.
+int rescanTokens(Document* doc, int restart, int end, int newEnd, LspToken** scanned, int* scannedCount) {
+  int delta = newEnd - end;
+  int maxCount = 0;
+  int kept = restart;
+  LspToken token;
+  jmp_buf recovery;
+
+  *scanned = NULL;
+  *scannedCount = 0;
+  startLexer(doc, (restart == 0) ? 0 : doc->tokens[restart - 1].end);
+
+  errorRecovery = &recovery;
+  if (setjmp(recovery) == 0) {
+    do {
+      lexToken(doc, &token);
+      while ((kept < doc->tokenCount) &&
+	     ((doc->tokens[kept].start < end) || (doc->tokens[kept].start + delta < token.start)))
+	kept ++;
+      if ((kept < doc->tokenCount) && (doc->tokens[kept].start + delta == token.start) &&
+	  (doc->tokens[kept].tokenType == token.tokenType))
+	break;
+      addToken(scanned, scannedCount, &maxCount, &token);
+    } while (token.tokenType != TK_EOF);
+    if (token.tokenType == TK_EOF) kept = doc->tokenCount;
+  } else {
+    // The tokens end at the first lexical error
+    doc->lexError = 1;
+    doc->lexErrorOffset = getOffset(doc, errorLineNo, errorColNo);
+    strcpy(doc->lexErrorMessage, errorMessage);
+    token.tokenType = TK_EOF;
+    token.string[0] = '\0';
+    token.value = 0;
+    token.start = doc->lexErrorOffset;
+    token.end = doc->lexErrorOffset;
+    addToken(scanned, scannedCount, &maxCount, &token);
+    kept = doc->tokenCount;
+  }
+  errorRecovery = NULL;
+  stopLexer();
+  return kept;
+}
+
+// Replace the tokens from first to kept by the tokens scanned, the tokens
+// kept move by delta
+void spliceTokens(Document* doc, int first, int kept, LspToken* scanned, int scannedCount, int delta) {
+  int keptCount = doc->tokenCount - kept;
+  int count = first + scannedCount + keptCount;
+  int i;
+
+  doc->tokens = growArray(doc->tokens, &doc->maxTokenCount, count, sizeof(LspToken));
+  memmove(doc->tokens + first + scannedCount, doc->tokens + kept, keptCount * sizeof(LspToken));
+  if (scannedCount > 0)
+    memcpy(doc->tokens + first, scanned, scannedCount * sizeof(LspToken));
+  for (i = first + scannedCount; i < count; i ++) {
+    doc->tokens[i].start += delta;
+    doc->tokens[i].end += delta;
+  }
+  doc->tokenCount = count;
+}
+
+void scanDocument(Document* doc) {
+  LspToken* scanned;
+  int scannedCount;
+
+  doc->tokenCount = 0;
+  doc->lexError = 0;
+  rescanTokens(doc, 0, 0, 0, &scanned, &scannedCount);
+  spliceTokens(doc, 0, 0, scanned, scannedCount, 0);
+  free(scanned);
+}
+
+// The first token ending at offset or after it
+int findToken(Document* doc, int offset) {
+  int low = 0;
+  int high = doc->tokenCount - 1;
+  int middle;
+
+  while (low < high) {
+    middle = (low + high) / 2;
+    if (doc->tokens[middle].end < offset) low = middle + 1;
+    else high = middle;
+  }
+  return low;
+}
+
+/******************************************************************/
+
+Document* streamDocument;
+int streamIndex;
+
+// The parser reads the tokens kept, then the last one, TK_EOF, again
+Token* readStreamToken(void) {
+  Document* doc = streamDocument;
+  LspToken* t = doc->tokens + ((streamIndex < doc->tokenCount) ? streamIndex : doc->tokenCount - 1);
+  Token* token;
+  int line, col;
+
+  getPosition(doc, t->start, &line, &col);
+  token = makeToken(t->tokenType, line, col);
+  memcpy(token->string, t->string, MAX_IDENT_LEN + 1);
+  token->value = t->value;
+  streamIndex ++;
+  return token;
+}
+
+void startStream(Document* doc, int first) {
+  streamDocument = doc;
+  streamIndex = first;
+  readToken = readStreamToken;
+  currentToken = NULL;
+  lookAhead = readToken();
+  initAst();
+}
+
+void stopStream(void) {
+  free(currentToken);
+  free(lookAhead);
+  currentToken = NULL;
+  lookAhead = NULL;
+  readToken = getValidToken;
+  errorRecovery = NULL;
+  cleanAst();
+}
+
+void keepParseError(Document* doc) {
+  doc->parseError = 1;
+  doc->parseErrorOffset = getOffset(doc, errorLineNo, errorColNo);
+  strcpy(doc->parseErrorMessage, errorMessage);
+}
+
+void enterDocument(Document* doc) {
+  symtab = doc->symtab;
+  intType = doc->intType;
+  charType = doc->charType;
+}
+
+void leaveDocument(Document* doc) {
+  symtab->currentScope = NULL;
+  doc->symtab = symtab;
+  doc->intType = intType;
+  doc->charType = charType;
+}
+
+Scope* getBlockScope(Object* owner) {
+  if (owner->kind == OBJ_FUNCTION)
+    return owner->funcAttrs->scope;
+  if (owner->kind == OBJ_PROCEDURE)
+    return owner->procAttrs->scope;
+  return owner->progAttrs->scope;
+}
+
+// The index of the semicolon ending the subprogram declared from the
+// token first, balancing BEGIN and END, or -1
+int findDeclarationEnd(Document* doc, int first) {
+  int pending = 0;
+  int depth = 0;
+  int i;
+
+  for (i = first; i < doc->tokenCount; i ++)
+    switch (doc->tokens[i].tokenType) {
+    case KW_FUNCTION:
+    case KW_PROCEDURE:
+      pending ++;
+      break;
+    case KW_BEGIN:
+      depth ++;
+      break;
+    case KW_END:
+      if (depth == 0) return -1;
+      depth --;
+      if ((depth == 0) && (-- pending == 0))
+	return (doc->tokens[i + 1].tokenType == SB_SEMICOLON) ? i + 1 : -1;
+      break;
+    case TK_EOF:
+      return -1;
+    default:
+      break;
+    }
+  return -1;
+}
+
+void addBlock(Document* doc, Object* owner, int first, int last) {
+  LspBlock* block;
+  int i = first + 2;
+
+  if (doc->tokens[i].tokenType == SB_LPAR)
+    while ((i < last) && (doc->tokens[i].tokenType != SB_RPAR))
+      i ++;
+  while ((i < last) && (doc->tokens[i].tokenType != SB_SEMICOLON))
+    i ++;
+
+  doc->blocks = growArray(doc->blocks, &doc->maxBlockCount, doc->blockCount, sizeof(LspBlock));
+  block = doc->blocks + doc->blockCount ++;
+  block->owner = owner;
+  block->first = first;
+  block->name = first + 1;
+  block->header = i;
+  block->last = last;
+}
+
+// The body of the program is a block too, from BEGIN to the period
+void addProgramBlock(Document* doc) {
+  LspBlock* block;
+  int depth = 0;
+  int first = -1;
+  int i = 2;
+  int j;
+
+  while ((i < doc->tokenCount) && (doc->tokens[i].tokenType != KW_BEGIN)) {
+    for (j = 0; j < doc->blockCount; j ++)
+      if (doc->blocks[j].first == i) 
+	i = doc->blocks[j].last;
+    i ++;
+  }
+  for (first = i; i < doc->tokenCount; i ++)
+    if (doc->tokens[i].tokenType == KW_BEGIN) depth ++;
+    else if ((doc->tokens[i].tokenType == KW_END) && (-- depth == 0)) break;
+  if ((i + 1 >= doc->tokenCount) || (doc->tokens[i + 1].tokenType != SB_PERIOD))
+    return;
+
+  doc->blocks = growArray(doc->blocks, &doc->maxBlockCount, doc->blockCount, sizeof(LspBlock));
+  block = doc->blocks + doc->blockCount ++;
+  block->owner = symtab->program;
+  block->first = first;
+  block->name = first;
+  block->header = first;
+  block->last = i + 1;
+}
+
+// The subprograms declared in the scope between the tokens from and to
+void collectBlocks(Document* doc, int from, int to, Scope* scope) {
+  Object* obj;
+  int i = from;
+  int last;
+
+  while (i < to) {
+    if (((doc->tokens[i].tokenType == KW_FUNCTION) || (doc->tokens[i].tokenType == KW_PROCEDURE)) &&
+	(doc->tokens[i + 1].tokenType == TK_IDENT)) {
+      last = findDeclarationEnd(doc, i);
+      obj = findObject(scope->objList, doc->tokens[i + 1].string);
+      if ((last >= 0) && (last <= to) && (obj != NULL) &&
+	  ((obj->kind == OBJ_FUNCTION) || (obj->kind == OBJ_PROCEDURE))) {
+	addBlock(doc, obj, i, last);
+	collectBlocks(doc, i + 2, last, getBlockScope(obj));
+	i = last + 1;
+	continue;
+      }
+    }
+    i ++;
+  }
+}
+
+void parseDocument(Document* doc) {
+  jmp_buf recovery;
+
+  enterDocument(doc);
+  if (symtab != NULL) cleanSymTab();
+  initSymTab();
+  usedUnitCount = 0;
+  externalCount = 0;
+  sourceFileName = doc->fileName;
+  doc->parseError = 0;
+  doc->complete = 0;
+  doc->blockCount = 0;
+
+  startStream(doc, 0);
+  errorRecovery = &recovery;
+  if (setjmp(recovery) == 0) {
+    if (lookAhead->tokenType == KW_UNIT)
+      buildUnit();
+    else buildProgram();
+    doc->complete = 1;
+  } else keepParseError(doc);
+  stopStream();
+
+  if (symtab->program != NULL) {
+    collectBlocks(doc, 0, doc->tokenCount - 1, symtab->program->progAttrs->scope);
+    if (doc->tokens[0].tokenType == KW_PROGRAM)
+      addProgramBlock(doc);
+  }
+  // Nothing follows an error in the body of the program
+  if (doc->parseError && (doc->blockCount > 0) && (doc->blocks[doc->blockCount - 1].owner->kind == OBJ_PROGRAM) &&
+      (doc->parseErrorOffset >= doc->tokens[doc->blocks[doc->blockCount - 1].first].end))
+    doc->complete = 1;
+  leaveDocument(doc);
+}
+
+// Parse the body of the program again
+int parseProgramBody(Document* doc, LspBlock* block) {
+  jmp_buf recovery;
+  int parsed = 0;
+
+  doc->parseError = 0;
+  symtab->currentScope = symtab->program->progAttrs->scope;
+  startStream(doc, block->first);
+  errorRecovery = &recovery;
+  if (setjmp(recovery) == 0) {
+    eat(KW_BEGIN);
+    buildStatements(createAstNode(AST_GROUP));
+    eat(KW_END);
+    eat(SB_PERIOD);
+    parsed = (streamIndex - 1 == block->last + 1);
+  } else {
+    keepParseError(doc);
+    parsed = (doc->parseErrorOffset <= doc->tokens[block->last].end);
+  }
+  stopStream();
+  if (parsed) addProgramBlock(doc);
+  return parsed;
+}
+
+// The node of the subprogram owning the scope, in the scope around it
+ObjectNode* findOwnerNode(Scope* scope) {
+  ObjectNode* node = scope->outer->objList;
+
+  while (node->object != scope->owner)
+    node = node->next;
+  return node;
+}
+
+// The objects declared after the subprograms around the scope are cut
+// from their scopes, a full parse has not seen them at the scope yet.
+// Returns the lists cut, from the innermost scope out.
+ObjectNode** cutLaterObjects(Scope* scope) {
+  ObjectNode** later;
+  ObjectNode* node;
+  Scope* s;
+  int count = 0;
+
+  for (s = scope; s->owner->kind != OBJ_PROGRAM; s = s->outer)
+    count ++;
+  later = (ObjectNode**) malloc((count + 1) * sizeof(ObjectNode*));
+  for (count = 0; scope->owner->kind != OBJ_PROGRAM; scope = scope->outer) {
+    node = findOwnerNode(scope);
+    later[count ++] = node->next;
+    node->next = NULL;
+  }
+  return later;
+}
+
+void restoreLaterObjects(Scope* scope, ObjectNode** later) {
+  int count;
+
+  for (count = 0; scope->owner->kind != OBJ_PROGRAM; scope = scope->outer)
+    findOwnerNode(scope)->next = later[count ++];
+  free(later);
+}
+
+// Parse the subprogram of a block again, in place of its object. Returns
+// 0 if its declaration does not end where the block does any more, the
+// whole document is to be parsed.
+int parseBlock(Document* doc, int index) {
+  LspBlock block = doc->blocks[index];
+  Scope* outer = getBlockScope(block.owner)->outer;
+  ObjectNode* previous = NULL;
+  ObjectNode* later;
+  ObjectNode** outerLater;
+  ObjectNode* node;
+  jmp_buf recovery;
+  int parsed = 0;
+  int i, j;
+
+  // The block and the blocks in it are found again
+  for (i = 0, j = 0; i < doc->blockCount; i ++)
+    if ((doc->blocks[i].first < block.first) || (doc->blocks[i].last > block.last))
+      doc->blocks[j ++] = doc->blocks[i];
+  doc->blockCount = j;
+
+  enterDocument(doc);
+  if (block.owner->kind == OBJ_PROGRAM) {
+    parsed = parseProgramBody(doc, &block);
+    leaveDocument(doc);
+    return parsed;
+  }
+  // The objects declared after the block are cut while it is parsed
+  for (node = outer->objList; node->object != block.owner; node = node->next)
+    previous = node;
+  if (previous == NULL) outer->objList = NULL;
+  else previous->next = NULL;
+  later = node->next;
+  freeObject(node->object);
+  free(node);
+  outerLater = cutLaterObjects(outer);
+
+  doc->parseError = 0;
+  symtab->currentScope = outer;
+  startStream(doc, block.first);
+  errorRecovery = &recovery;
+  if (setjmp(recovery) == 0) {
+    if (lookAhead->tokenType == KW_FUNCTION)
+      buildFuncDecl();
+    else buildProcDecl();
+    parsed = (streamIndex - 1 == block.last + 1);
+  } else {
+    keepParseError(doc);
+    parsed = (doc->parseErrorOffset <= doc->tokens[block.last].end);
+  }
+  stopStream();
+
+  // The new object is the last one of the scope, the objects cut follow it
+  restoreLaterObjects(outer, outerLater);
+  node = (previous == NULL) ? outer->objList : previous->next;
+  if (node != NULL) {
+    node->next = later;
+    addBlock(doc, node->object, block.first, block.last);
+    collectBlocks(doc, block.first + 2, block.last, getBlockScope(node->object));
+  } else {
+    if (previous == NULL) outer->objList = later;
+    else previous->next = later;
+    parsed = 0;
+  }
+
+  leaveDocument(doc);
+  return parsed;
+}
+
+// The objects declared after the change move with the text
+void moveObjects(ObjectNode* objList, int line, int col, int newLine, int newCol) {
+  Object* obj;
+
+  for (; objList != NULL; objList = objList->next) {
+    obj = objList->object;
+    if ((obj->lineNo > line) || ((obj->lineNo == line) && (obj->colNo >= col))) {
+      if (obj->lineNo == line)
+	obj->colNo += newCol - col;
+      obj->lineNo += newLine - line;
+    }
+    if ((obj->kind == OBJ_FUNCTION) || (obj->kind == OBJ_PROCEDURE))
+      moveObjects(getBlockScope(obj)->objList, line, col, newLine, newCol);
+  }
+}
+
+// The innermost block around the change whose header is unchanged
+int findChangedBlock(Document* doc, int first, int kept) {
+  int found = -1;
+  int i;
+
+  for (i = 0; i < doc->blockCount; i ++)
+    if ((doc->blocks[i].header < first) && (kept <= doc->blocks[i].last) &&
+	((found < 0) || (doc->blocks[i].first > doc->blocks[found].first)))
+      found = i;
+  return found;
+}
+
+// The text from start to end is replaced
+void changeDocument(Document* doc, int start, int end, char* text) {
+  int newEnd = start + strlen(text);
+  int delta = newEnd - end;
+  int line, col, newLine, newCol;
+  int first, kept, block, tokenDelta, i;
+  int blockStart, blockEnd;
+  LspToken* scanned;
+  int scannedCount;
+  int wasScanned = !doc->lexError;
+
+  getPosition(doc, end, &line, &col);
+  replaceText(doc, start, end, text);
+  getPosition(doc, newEnd, &newLine, &newCol);
+
+  if (!wasScanned) {
+    scanDocument(doc);
+    parseDocument(doc);
+    return;
+  }
+
+  // A token ending where the change starts may join the new text
+  first = findToken(doc, start);
+  kept = rescanTokens(doc, first, end, newEnd, &scanned, &scannedCount);
+  tokenDelta = scannedCount - (kept - first);
+
+  block = -1;
+  if (doc->complete && !doc->lexError)
+    block = findChangedBlock(doc, first, kept);
+  if (block >= 0) {
+    blockStart = doc->tokens[doc->blocks[block].first].start;
+    blockEnd = doc->tokens[doc->blocks[block].last].end;
+    if (doc->parseError && ((doc->parseErrorOffset < blockStart) || (doc->parseErrorOffset > blockEnd)))
+      block = -1;
+  }
+
+  spliceTokens(doc, first, kept, scanned, scannedCount, delta);
+  free(scanned);
+  if (block < 0) {
+    parseDocument(doc);
+    return;
+  }
+
+  for (i = 0; i < doc->blockCount; i ++)
+    if (doc->blocks[i].first >= kept) {
+      doc->blocks[i].first += tokenDelta;
+      doc->blocks[i].name += tokenDelta;
+      doc->blocks[i].header += tokenDelta;
+      doc->blocks[i].last += tokenDelta;
+    } else if (doc->blocks[i].last >= kept)
+      doc->blocks[i].last += tokenDelta;
+  if (doc->symtab->program != NULL)
+    moveObjects(doc->symtab->program->progAttrs->scope->objList, line, col, newLine, newCol);
+
+  if (!parseBlock(doc, block))
+    parseDocument(doc);
+}
+
+Document* openDocument(char* uri, char* text) {
+  Document* doc = (Document*) calloc(1, sizeof(Document));
+
+  doc->uri = strdup(uri);
+  doc->fileName = strdup((strncmp(uri, "file://", 7) == 0) ? uri + 7 : uri);
+  doc->text = growArray(NULL, &doc->maxLength, 0, 1);
+  doc->text[0] = '\0';
+  replaceText(doc, 0, 0, text);
+  scanDocument(doc);
+  parseDocument(doc);
+  return doc;
+}
+
+void closeDocument(Document* doc) {
+  enterDocument(doc);
+  cleanSymTab();
+  free(doc->uri);
+  free(doc->fileName);
+  free(doc->text);
+  free(doc->lineStarts);
+  free(doc->tokens);
+  free(doc->blocks);
+  free(doc);
+}
+
+// The object named by the identifier at offset, as the parser found it
+Object* findDeclaration(Document* doc, int offset) {
+  int index = findToken(doc, offset);
+  LspToken* token = doc->tokens + index;
+  Scope* scope = NULL;
+  Object* obj;
+  int name = -1;
+  int i;
+
+  // The cursor may be just after an identifier
+  if ((token->end == offset) && (index + 1 < doc->tokenCount) && (token[1].start == offset))
+    token ++;
+  if ((token->tokenType != TK_IDENT) || (token->start > offset) || (doc->symtab->program == NULL))
+    return NULL;
+  index = token - doc->tokens;
+  if (index == 1)
+    return doc->symtab->program;
+
+  scope = doc->symtab->program->progAttrs->scope;
+  for (i = 0; i < doc->blockCount; i ++)
+    if ((doc->blocks[i].name < index) && (index <= doc->blocks[i].last) && (doc->blocks[i].name > name)) {
+      name = doc->blocks[i].name;
+      scope = getBlockScope(doc->blocks[i].owner);
+    }
+
+  enterDocument(doc);
+  symtab->currentScope = scope;
+  obj = lookupObject(token->string);
+  leaveDocument(doc);
+  return obj;
+}
+
+/******************************************************************/
+
+// The messages are JSON-RPC, each after a Content-Length header
+
+char* output = NULL;
+int outputLength = 0;
+int maxOutputLength = 0;
+
+void appendOutput(char* format, ...) {
+  va_list args;
+  int length;
+
+  va_start(args, format);
+  length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  output = growArray(output, &maxOutputLength, outputLength + length + 1, 1);
+  va_start(args, format);
+  vsnprintf(output + outputLength, length + 1, format, args);
+  va_end(args);
+  outputLength += length;
+}
+
+void appendString(char* s) {
+  appendOutput("\"");
+  for (; *s != '\0'; s ++)
+    if ((*s == '"') || (*s == '\\'))
+      appendOutput("\\%c", *s);
+    else if ((unsigned char) *s < ' ')
+      appendOutput("\\u%04x", *s);
+    else appendOutput("%c", *s);
+  appendOutput("\"");
+}
+
+void sendOutput(void) {
+  printf("Content-Length: %d\r\n\r\n%s", outputLength, output);
+  fflush(stdout);
+  outputLength = 0;
+}
+
+void appendRange(Document* doc, int start, int end) {
+  int line, col, endLine, endCol;
+
+  getPosition(doc, start, &line, &col);
+  getPosition(doc, end, &endLine, &endCol);
+  appendOutput("{\"start\":{\"line\":%d,\"character\":%d},\"end\":{\"line\":%d,\"character\":%d}}",
+	       line - 1, col - 1, endLine - 1, endCol - 1);
+}
+
+// The body of the next message, NULL at the end of the input
+char* readMessage(void) {
+  char header[MAX_HEADER_LEN];
+  char* body;
+  int length = -1;
+
+  while (fgets(header, MAX_HEADER_LEN, stdin) != NULL) {
+    if ((strcmp(header, "\r\n") == 0) || (strcmp(header, "\n") == 0)) {
+      if (length >= 0) break;
+    } else if (strncasecmp(header, "Content-Length:", 15) == 0)
+      length = atoi(header + 15);
+  }
+  if (length < 0) return NULL;
+
+  body = (char*) malloc(length + 1);
+  if (fread(body, 1, length, stdin) != length) {
+    free(body);
+    return NULL;
+  }
+  body[length] = '\0';
+  return body;
+}
+
+char* skipSpaces(char* p) {
+  while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+    p ++;
+  return p;
+}
+
+// After the JSON value at p, NULL if it is not one
+char* skipValue(char* p) {
+  char close;
+  int depth;
+
+  if (p == NULL) return NULL;
+  p = skipSpaces(p);
+  switch (*p) {
+  case '"':
+    for (p ++; *p != '"'; p ++) {
+      if (*p == '\0') return NULL;
+      if ((*p == '\\') && (*(++ p) == '\0')) return NULL;
+    }
+    return p + 1;
+  case '{':
+  case '[':
+    close = (*p == '{') ? '}' : ']';
+    p = skipSpaces(p + 1);
+    if (*p == close) return p + 1;
+    while (1) {
+      if (close == '}') {
+	p = skipValue(p);
+	if (p == NULL) return NULL;
+	p = skipSpaces(p);
+	if (*p != ':') return NULL;
+	p ++;
+      }
+      p = skipValue(p);
+      if (p == NULL) return NULL;
+      p = skipSpaces(p);
+      if (*p == close) return p + 1;
+      if (*p != ',') return NULL;
+      p ++;
+    }
+  default:
+    for (depth = 0; (*p != '\0') && (strchr(",:]} \t\r\n", *p) == NULL); p ++)
+      depth ++;
+    return (depth > 0) ? p : NULL;
+  }
+}
+
+// The value of a member of the JSON object at p, or NULL
+char* getMember(char* p, char* key) {
+  int length = strlen(key);
+  char* name;
+
+  if (p == NULL) return NULL;
+  p = skipSpaces(p);
+  if (*p != '{') return NULL;
+  p = skipSpaces(p + 1);
+  while (*p == '"') {
+    name = p + 1;
+    p = skipValue(p);
+    if (p == NULL) return NULL;
+    p = skipSpaces(p);
+    if (*p != ':') return NULL;
+    p = skipSpaces(p + 1);
+    if ((p - name >= length + 1) && (strncmp(name, key, length) == 0) && (name[length] == '"'))
+      return p;
+    p = skipValue(p);
+    if (p == NULL) return NULL;
+    p = skipSpaces(p);
+    if (*p != ',') return NULL;
+    p = skipSpaces(p + 1);
+  }
+  return NULL;
+}
+
+int getInt(char* p, int defaultValue) {
+  if ((p == NULL) || ((*p != '-') && ((*p < '0') || (*p > '9'))))
+    return defaultValue;
+  return atoi(p);
+}
+
+void appendUtf8(char** q, unsigned code) {
+  if (code < 0x80)
+    *(*q) ++ = code;
+  else if (code < 0x800) {
+    *(*q) ++ = 0xC0 | (code >> 6);
+    *(*q) ++ = 0x80 | (code & 0x3F);
+  } else if (code < 0x10000) {
+    *(*q) ++ = 0xE0 | (code >> 12);
+    *(*q) ++ = 0x80 | ((code >> 6) & 0x3F);
+    *(*q) ++ = 0x80 | (code & 0x3F);
+  } else {
+    *(*q) ++ = 0xF0 | (code >> 18);
+    *(*q) ++ = 0x80 | ((code >> 12) & 0x3F);
+    *(*q) ++ = 0x80 | ((code >> 6) & 0x3F);
+    *(*q) ++ = 0x80 | (code & 0x3F);
+  }
+}
+
+// The JSON string at p, unescaped, or NULL
+char* getString(char* p) {
+  char* end = skipValue(p);
+  char* s;
+  char* q;
+  unsigned code, low;
+
+  if ((p == NULL) || (*p != '"') || (end == NULL)) return NULL;
+  s = q = (char*) malloc(end - p);
+  for (p ++; *p != '"'; p ++) {
+    if (*p != '\\') {
+      *q ++ = *p;
+      continue;
+    }
+    switch (*(++ p)) {
+    case 'b': *q ++ = '\b'; break;
+    case 'f': *q ++ = '\f'; break;
+    case 'n': *q ++ = '\n'; break;
+    case 'r': *q ++ = '\r'; break;
+    case 't': *q ++ = '\t'; break;
+    case 'u':
+      if (sscanf(p + 1, "%4x", &code) != 1) code = '?';
+      p += 4;
+      if ((code >= 0xD800) && (code < 0xDC00) && (p[1] == '\\') && (p[2] == 'u') &&
+	  (sscanf(p + 3, "%4x", &low) == 1)) {
+	code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+	p += 6;
+      }
+      appendUtf8(&q, code);
+      break;
+    default: *q ++ = *p;
+    }
+  }
+  *q = '\0';
+  return s;
+}
+
+/******************************************************************/
+
+Document* findDocument(char* params) {
+  char* uri = getString(getMember(getMember(params, "textDocument"), "uri"));
+  Document* doc = NULL;
+  int i;
+
+  if (uri == NULL) return NULL;
+  for (i = 0; i < documentCount; i ++)
+    if (strcmp(documents[i]->uri, uri) == 0)
+      doc = documents[i];
+  free(uri);
+  return doc;
+}
+
+// LSP positions count lines and characters from 0
+int getLspOffset(Document* doc, char* position) {
+  return getOffset(doc, getInt(getMember(position, "line"), 0) + 1,
+		   getInt(getMember(position, "character"), 0) + 1);
+}
+
+void publishDiagnostics(Document* doc) {
+  appendOutput("{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+  appendString(doc->uri);
+  appendOutput(",\"diagnostics\":[");
+  if (doc->lexError) {
+    appendOutput("{\"range\":");
+    appendRange(doc, doc->lexErrorOffset, doc->lexErrorOffset);
+    appendOutput(",\"severity\":1,\"source\":\"kplc\",\"message\":");
+    appendString(doc->lexErrorMessage);
+    appendOutput("}");
+  }
+  // The tokens end at a lexical error, the parser fails there
+  if (doc->parseError && (!doc->lexError || (doc->parseErrorOffset < doc->lexErrorOffset))) {
+    appendOutput("%s{\"range\":", doc->lexError ? "," : "");
+    appendRange(doc, doc->parseErrorOffset, doc->parseErrorOffset);
+    appendOutput(",\"severity\":1,\"source\":\"kplc\",\"message\":");
+    appendString(doc->parseErrorMessage);
+    appendOutput("}");
+  }
+  appendOutput("]}}");
+  sendOutput();
+}
+
+void appendType(Type* type) {
+  if (type == NULL) return;
+  switch (type->typeClass) {
+  case TP_INT: appendOutput("INTEGER"); break;
+  case TP_CHAR: appendOutput("CHAR"); break;
+  case TP_ARRAY:
+    appendOutput("ARRAY(. %d .) OF ", type->arraySize);
+    appendType(type->elementType);
+    break;
+  }
+}
+
+void appendParams(ObjectNode* paramList) {
+  if (paramList == NULL) return;
+  appendOutput("(");
+  for (; paramList != NULL; paramList = paramList->next) {
+    if (paramList->object->paramAttrs->kind == PARAM_REFERENCE)
+      appendOutput("VAR ");
+    appendOutput("%s: ", paramList->object->name);
+    appendType(paramList->object->paramAttrs->type);
+    if (paramList->next != NULL) appendOutput("; ");
+  }
+  appendOutput(")");
+}
+
+// The object as it is declared
+void appendDeclaration(Object* obj) {
+  ConstantValue* value;
+
+  switch (obj->kind) {
+  case OBJ_CONSTANT:
+    value = obj->constAttrs->value;
+    if (value == NULL)
+      appendOutput("CONST %s", obj->name);
+    else if (value->type == TP_INT)
+      appendOutput("CONST %s = %d", obj->name, value->intValue);
+    else appendOutput("CONST %s = \'%c\'", obj->name, value->charValue);
+    break;
+  case OBJ_VARIABLE:
+    appendOutput("VAR %s: ", obj->name);
+    appendType(obj->varAttrs->type);
+    break;
+  case OBJ_TYPE:
+    appendOutput("TYPE %s = ", obj->name);
+    appendType(obj->typeAttrs->actualType);
+    break;
+  case OBJ_FUNCTION:
+    appendOutput("FUNCTION %s", obj->name);
+    appendParams(obj->funcAttrs->paramList);
+    appendOutput(": ");
+    appendType(obj->funcAttrs->returnType);
+    break;
+  case OBJ_PROCEDURE:
+    appendOutput("PROCEDURE %s", obj->name);
+    appendParams(obj->procAttrs->paramList);
+    break;
+  case OBJ_PARAMETER:
+    appendOutput("%s%s: ", (obj->paramAttrs->kind == PARAM_REFERENCE) ? "VAR " : "", obj->name);
+    appendType(obj->paramAttrs->type);
+    break;
+  case OBJ_PROGRAM:
+    appendOutput("PROGRAM %s", obj->name);
+    break;
+  }
+}
+
+void appendHover(Object* obj) {
+  int mark = outputLength;
+  char* declaration;
+
+  // The declaration is written, then escaped as a string
+  appendDeclaration(obj);
+  declaration = strdup(output + mark);
+  outputLength = mark;
+  appendOutput("{\"contents\":{\"kind\":\"plaintext\",\"value\":");
+  appendString(declaration);
+  appendOutput("}}");
+  free(declaration);
+}
+
+void appendLocation(Document* doc, Object* obj) {
+  int start;
+
+  // The predefined and imported objects are not in the document
+  if (obj->lineNo == 0) {
+    appendOutput("null");
+    return;
+  }
+  start = getOffset(doc, obj->lineNo, obj->colNo);
+  appendOutput("{\"uri\":");
+  appendString(doc->uri);
+  appendOutput(",\"range\":");
+  appendRange(doc, start, start + strlen(obj->name));
+  appendOutput("}");
+}
+
+void applyChanges(Document* doc, char* changes) {
+  char* change;
+  char* range;
+  char* text;
+  int start, end;
+
+  change = skipSpaces(changes);
+  if (*change != '[') return;
+  change = skipSpaces(change + 1);
+  while ((*change == '{') && ((text = getString(getMember(change, "text"))) != NULL)) {
+    range = getMember(change, "range");
+    if (range == NULL) {
+      start = 0;
+      end = doc->length;
+    } else {
+      start = getLspOffset(doc, getMember(range, "start"));
+      end = getLspOffset(doc, getMember(range, "end"));
+      if (end < start) end = start;
+    }
+    changeDocument(doc, start, end, text);
+    free(text);
+
+    change = skipValue(change);
+    if (change == NULL) return;
+    change = skipSpaces(change);
+    if (*change != ',') return;
+    change = skipSpaces(change + 1);
+  }
+}
+
+// Returns 0 at the exit notification
+int handleMessage(char* message, int* shutdown) {
+  char* method = getString(getMember(message, "method"));
+  char* id = getMember(message, "id");
+  char* params = getMember(message, "params");
+  char* idEnd = skipValue(id);
+  int idLength = (idEnd == NULL) ? 0 : idEnd - id;
+  Document* doc;
+  Object* obj;
+  char* uri;
+  char* text;
+  int i;
+
+  if (method == NULL) return 1;
+
+  if (strcmp(method, "exit") == 0) {
+    free(method);
+    return 0;
+  }
+
+  if (strcmp(method, "textDocument/didOpen") == 0) {
+    uri = getString(getMember(getMember(params, "textDocument"), "uri"));
+    text = getString(getMember(getMember(params, "textDocument"), "text"));
+    if ((uri != NULL) && (text != NULL) && (findDocument(params) == NULL) && (documentCount < MAX_DOCUMENTS)) {
+      doc = openDocument(uri, text);
+      documents[documentCount ++] = doc;
+      publishDiagnostics(doc);
+    }
+    free(uri);
+    free(text);
+  } else if (strcmp(method, "textDocument/didChange") == 0) {
+    doc = findDocument(params);
+    if (doc != NULL) {
+      applyChanges(doc, getMember(params, "contentChanges"));
+      publishDiagnostics(doc);
+    }
+  } else if (strcmp(method, "textDocument/didClose") == 0) {
+    doc = findDocument(params);
+    for (i = 0; i < documentCount; i ++)
+      if (documents[i] == doc) {
+	closeDocument(doc);
+	documents[i] = documents[-- documentCount];
+      }
+  } else if (id != NULL) {
+    // A request, answered with the same id
+    appendOutput("{\"jsonrpc\":\"2.0\",\"id\":%.*s,", idLength, id);
+    if (strcmp(method, "initialize") == 0)
+      appendOutput("\"result\":{\"capabilities\":{\"textDocumentSync\":2,\"hoverProvider\":true,"
+		   "\"definitionProvider\":true},\"serverInfo\":{\"name\":\"kplc\"}}}");
+    else if (strcmp(method, "shutdown") == 0) {
+      *shutdown = 1;
+      appendOutput("\"result\":null}");
+    } else if ((strcmp(method, "textDocument/hover") == 0) || (strcmp(method, "textDocument/definition") == 0)) {
+      doc = findDocument(params);
+      obj = NULL;
+      if (doc != NULL)
+	obj = findDeclaration(doc, getLspOffset(doc, getMember(params, "position")));
+      appendOutput("\"result\":");
+      if (obj == NULL)
+	appendOutput("null");
+      else if (method[13] == 'h')
+	appendHover(obj);
+      else appendLocation(doc, obj);
+      appendOutput("}");
+    } else appendOutput("\"error\":{\"code\":-32601,\"message\":\"Method not found\"}}");
+    sendOutput();
+  }
+  free(method);
+  return 1;
+}
+
+int runLanguageServer(void) {
+  char* message;
+  int shutdown = 0;
+  int running = 1;
+
+  while (running && ((message = readMessage()) != NULL)) {
+    running = handleMessage(message, &shutdown);
+    free(message);
+  }
+  while (documentCount > 0)
+    closeDocument(documents[-- documentCount]);
+  return shutdown ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __LSP_H__
+#define __LSP_H__
+
+#include "token.h"
+#include "symtab.h"
+#include "error.h"
+
+#define MAX_DOCUMENTS 64
+#define MAX_HEADER_LEN 256
+
+// A token kept with its place in the text, from start to end excluded
+struct LspToken_ {
+  TokenType tokenType;
+  char string[MAX_IDENT_LEN + 1];
+  int value;
+  int start, end;
+};
+
+typedef struct LspToken_ LspToken;
+
+// A subprogram declared, from its keyword to its last semicolon, as token
+// indexes. Its scope begins after its name, its header ends at the
+// semicolon after its parameters.
+struct LspBlock_ {
+  Object* owner;
+  int first, name, header, last;
+};
+
+typedef struct LspBlock_ LspBlock;
+
+// An open document, with its tokens and its symbol table
+struct Document_ {
+  char* uri;
+  char* fileName;
+
+  char* text;
+  int length, maxLength;
+  int* lineStarts;
+  int lineCount, maxLineCount;
+
+  LspToken* tokens;
+  int tokenCount, maxTokenCount;
+  LspBlock* blocks;
+  int blockCount, maxBlockCount;
+
+  SymTab* symtab;
+  Type* intType;
+  Type* charType;
+
+  // The tokens end at a lexical error. The parser stops at an error,
+  // the document is complete if it is in a block parsed again.
+  int lexError, parseError, complete;
+  int lexErrorOffset, parseErrorOffset;
+  char lexErrorMessage[MAX_ERROR_LEN];
+  char parseErrorMessage[MAX_ERROR_LEN];
+};
+
+typedef struct Document_ Document;
+
+Document* openDocument(char* uri, char* text);
+void closeDocument(Document* doc);
+void changeDocument(Document* doc, int start, int end, char* text);
+void scanDocument(Document* doc);
+void parseDocument(Document* doc);
+int parseBlock(Document* doc, int block);
+Object* findDeclaration(Document* doc, int offset);
+
+int runLanguageServer(void);
+
+#endif
@@ -0,0 +1,678 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "codegen.h"
+#include "optimizer.h"
+
+extern __thread CodeBlock* codeBlock;
+
+/******************* Range analysis ******************************/
+
+int isLocalAccess(Instruction* inst, enum OpCode op, WORD offset) {
+  return ((inst->op == op) && (inst->p == 0) && (inst->q == offset));
+}
+
+// The loop variable may change inside the body if its address is taken
+// or if a procedure/function is called (through a static link)
+int isModifiedIn(CodeAddress start, WORD offset) {
+  CodeAddress i;
+  Instruction* inst;
+
+  for (i = start; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if (inst->op == OP_CALL) return 1;
+    if (isLocalAccess(inst, OP_LA, offset)) return 1;
+  }
+  return 0;
+}
+
+// Recognize the index expressions i, i + c and i - c ending right before bc
+int getIndexDelta(CodeAddress bc, WORD offset, WORD* delta) {
+  Instruction* inst = codeBlock->code + bc;
+
+  if ((bc >= 1) && isLocalAccess(inst - 1, OP_LV, offset)) {
+    *delta = 0;
+    return 1;
+  }
+  if ((bc >= 3) && isLocalAccess(inst - 3, OP_LV, offset) && ((inst - 2)->op == OP_LC)) {
+    if ((inst - 1)->op == OP_AD) {
+      *delta = (inst - 2)->q;
+      return 1;
+    } 
+    if ((inst - 1)->op == OP_SB) {
+      *delta = - (inst - 2)->q;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void removeSafeBoundsChecks(Instruction* loopVar, WORD low, WORD high, CodeAddress bodyStart) {
+  CodeAddress i = bodyStart;
+  Instruction* inst;
+  WORD offset;
+  WORD delta;
+
+  // Only a local of the current frame cannot be aliased
+  if ((loopVar->op != OP_LA) || (loopVar->p != 0)) return;
+  offset = loopVar->q;
+
+  if (isModifiedIn(bodyStart, offset)) return;
+
+  while (i < codeBlock->codeSize) {
+    inst = codeBlock->code + i;
+    if ((inst->op == OP_BC) && getIndexDelta(i, offset, &delta) &&
+	(low + delta >= 0) && (high + delta < inst->q))
+      removeCode(i);
+    else i ++;
+  }
+}
+
+/******************* Inlining ******************************/
+
+int isTerminal(enum OpCode op) {
+  return ((op == OP_J) || (op == OP_HL) || (op == OP_EP) || (op == OP_EF));
+}
+
+// Number of words above the frame before each instruction of a body,
+// up to address. The body starts with the INT allocating the frame. 
+// Code is structured, so one forward pass is enough. Unpatched jumps
+// are ignored. The result is indexed from bodyAddress.
+int* computeStackDepths(CodeAddress bodyAddress, CodeAddress address) {
+  int size = address - bodyAddress + 1;
+  int* depths = (int*) malloc(size * sizeof(int));
+  Instruction* inst;
+  int i, depth, target;
+
+  for (i = 0; i < size; i ++) depths[i] = UNKNOWN_DEPTH;
+  depths[1] = 0;
+
+  for (i = 1; i < size - 1; i ++) {
+    if (depths[i] == UNKNOWN_DEPTH) continue;
+    inst = codeBlock->code + bodyAddress + i;
+    depth = depths[i] + getStackEffect(inst);
+
+    if (!isTerminal(inst->op) && (depths[i + 1] == UNKNOWN_DEPTH))
+      depths[i + 1] = depth;
+
+    if (isBranchInstruction(inst->op)) {
+      target = inst->q - bodyAddress;
+      if ((target > i) && (target < size) && (depths[target] == UNKNOWN_DEPTH))
+	depths[target] = depth;
+    }
+  }
+  return depths;
+}
+
+int getStackDepth(CodeAddress bodyAddress, CodeAddress address) {
+  int* depths = computeStackDepths(bodyAddress, address);
+  int depth = depths[address - bodyAddress];
+
+  free(depths);
+  return depth;
+}
+
+// Find the instruction ending a subprogram body, or -1
+CodeAddress getBodyEnd(CodeAddress bodyAddress) {
+  CodeAddress i;
+  Instruction* inst;
+
+  for (i = bodyAddress + 1; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if ((inst->op == OP_EP) || (inst->op == OP_EF))
+      return i;
+  }
+  return -1;
+}
+
+// A small, completely generated subprogram which calls nothing
+int isInlinable(CodeAddress codeAddress) {
+  Instruction* jmp;
+  CodeAddress bodyAddress;
+  CodeAddress end;
+  CodeAddress i;
+
+  // A subprogram of another unit is not known before it is linked
+  if (codeAddress < 0) return 0;
+  jmp = codeBlock->code + codeAddress;
+  if ((jmp->op != OP_J) || (jmp->q <= codeAddress)) return 0;
+  bodyAddress = jmp->q;
+  if (codeBlock->code[bodyAddress].op != OP_INT) return 0;
+
+  end = getBodyEnd(bodyAddress);
+  if ((end < 0) || (end - bodyAddress - 1 > INLINE_THRESHOLD)) return 0;
+
+  for (i = bodyAddress + 1; i < end; i ++)
+    if ((codeBlock->code[i].op == OP_CALL) || (codeBlock->code[i].op == OP_HL))
+      return 0;
+  return 1;
+}
+
+// Copy the body of a subprogram at the current address. The caller has
+// pushed argWords words of its frame, starting at frameBase in the
+// current frame. The subprogram is declared level scopes outside.
+void inlineBody(CodeAddress codeAddress, int level, WORD frameBase, int argWords) {
+  CodeAddress bodyAddress = codeBlock->code[codeAddress].q;
+  CodeAddress end = getBodyEnd(bodyAddress);
+  WORD frameSize = codeBlock->code[bodyAddress].q;
+  CodeAddress shift;
+  CodeAddress i;
+  Instruction inst;
+
+  // Allocate the local variables
+  if (frameSize > argWords)
+    emitINT(codeBlock, frameSize - argWords);
+
+  shift = codeBlock->codeSize - (bodyAddress + 1);
+  for (i = bodyAddress + 1; i < end; i ++) {
+    inst = codeBlock->code[i];
+    switch (inst.op) {
+    case OP_LA:
+    case OP_LV:
+      // The frame of the subprogram lies inside the current frame
+      if (inst.p == 0)
+	inst.q += frameBase;
+      else inst.p += level - 1;
+      break;
+    default:
+      if (isBranchInstruction(inst.op))
+	inst.q += shift;
+      break;
+    }
+    emitCode(codeBlock, inst.op, inst.p, inst.q);
+  }
+
+  // Leave the return value (or the caller's top) on the top
+  emitDCT(codeBlock, frameSize - 1);
+}
+
+/******************* Tail calls ******************************/
+
+// Follow the jumps from address: does the execution reach end directly?
+int reachesEnd(CodeAddress address, CodeAddress end) {
+  while ((address < end) && (codeBlock->code[address].op == OP_J) && 
+	 (codeBlock->code[address].q > address))
+    address = codeBlock->code[address].q;
+  return (address == end);
+}
+
+void setInstruction(Instruction* inst, enum OpCode op, WORD p, WORD q) {
+  inst->op = op;
+  inst->p = p;
+  inst->q = q;
+}
+
+int takesLocalAddress(CodeAddress start, CodeAddress end) {
+  CodeAddress i;
+
+  for (i = start; i < end; i ++)
+    if ((codeBlock->code[i].op == OP_LA) && (codeBlock->code[i].p == 0) && 
+	(codeBlock->code[i].q >= RESERVED_WORDS))
+      return 1;
+  return 0;
+}
+
+// Find a self call in tail position, between bodyAddress and end. 
+// The call must be a whole statement of the top level of the body:
+//    LA 0,RETURN_VALUE_OFFSET  INT RESERVED_WORDS  args  DCT  CALL 1,self  ST
+// for a function, or 
+//    INT PROCEDURE_RESERVED_WORDS  args  DCT  CALL 1,self
+// for a procedure, followed by nothing but jumps until end.
+int findTailCall(CodeAddress codeAddress, CodeAddress bodyAddress, CodeAddress end, TailCall* tailCall) {
+  int* depths = computeStackDepths(bodyAddress, end);
+  Instruction* code = codeBlock->code;
+  CodeAddress call, first;
+  int frame, depth;
+  int found = 0;
+
+  for (call = bodyAddress + 2; (call < end) && !found; call ++) {
+    if ((code[call].op != OP_CALL) || (code[call].p != 1) || (code[call].q != codeAddress)) 
+      continue;
+    if ((code[call - 1].op != OP_DCT) || (depths[call - 1 - bodyAddress] == UNKNOWN_DEPTH))
+      continue;
+
+    if ((call + 1 < end) && (code[call + 1].op == OP_ST)) {
+      frame = RESERVED_WORDS;
+      tailCall->end = call + 2;
+    } else {
+      frame = PROCEDURE_RESERVED_WORDS;
+      tailCall->end = call + 1;
+    }
+    if (!reachesEnd(tailCall->end, end)) continue;
+
+    // The INT allocating the callee frame, which stays allocated until the DCT
+    tailCall->argCount = code[call - 1].q - RESERVED_WORDS;
+    depth = depths[call - 1 - bodyAddress] - frame - tailCall->argCount;
+    for (first = call - 2; first > bodyAddress; first --)
+      if (depths[first - bodyAddress] <= depth) break;
+    if ((depths[first - bodyAddress] != depth) || 
+	(code[first].op != OP_INT) || (code[first].q != frame)) 
+      continue;
+
+    tailCall->args = first + 1;
+    tailCall->argsEnd = call - 1;
+    // An address in the current frame, passed by reference, would point 
+    // into the frame reused by the jump
+    if (takesLocalAddress(tailCall->args, tailCall->argsEnd)) continue;
+    if (frame == RESERVED_WORDS) {
+      first --;
+      if ((code[first].op != OP_LA) || (code[first].p != 0) || 
+	  (code[first].q != RETURN_VALUE_OFFSET))
+	continue;
+    }
+    if (depths[first - bodyAddress] != 0) continue;
+
+    tailCall->start = first;
+    tailCall->argsDepth = depths[tailCall->args - bodyAddress];
+    found = 1;
+  }
+
+  free(depths);
+  return found;
+}
+
+// Turn the self calls in tail position of the subprogram being generated
+// into an update of its parameters and a jump to the start of its body
+void eliminateTailCalls(CodeAddress codeAddress) {
+  CodeAddress bodyAddress = codeBlock->code[codeAddress].q;
+  WORD frameSize = codeBlock->code[bodyAddress].q;
+  TailCall tailCall;
+  Instruction* code;
+  Instruction* inst;
+  CodeAddress i;
+  int words, shift, n, k, success;
+
+  while (findTailCall(codeAddress, bodyAddress, codeBlock->codeSize, &tailCall)) {
+    // The arguments are computed at the same depth as before, as they
+    // may contain inlined calls. They are copied to the parameters once 
+    // all of them are computed.
+    words = tailCall.argsDepth;
+    shift = tailCall.start + 1 - tailCall.args;
+    code = (Instruction*) malloc((tailCall.argsEnd - tailCall.args + 3 * tailCall.argCount + 3) * sizeof(Instruction));
+
+    n = 0;
+    setInstruction(code + (n ++), OP_INT, DC_VALUE, words);
+    for (i = tailCall.args; i < tailCall.argsEnd; i ++) {
+      inst = code + (n ++);
+      *inst = codeBlock->code[i];
+      if (isBranchInstruction(inst->op) && (inst->q >= tailCall.args))
+	inst->q += shift;
+    }
+    for (k = 0; k < tailCall.argCount; k ++) {
+      setInstruction(code + (n ++), OP_LA, 0, RESERVED_WORDS + k);
+      setInstruction(code + (n ++), OP_LV, 0, frameSize + words + k);
+      setInstruction(code + (n ++), OP_ST, DC_VALUE, DC_VALUE);
+    }
+    setInstruction(code + (n ++), OP_DCT, DC_VALUE, words + tailCall.argCount);
+    setInstruction(code + (n ++), OP_J, DC_VALUE, bodyAddress + 1);
+
+    success = replaceCode(tailCall.start, tailCall.end - tailCall.start, code, n);
+    free(code);
+    if (!success) break;
+  }
+}
+
+/******************* Loop invariants ******************************/
+
+// Invariant code reads nothing but constants and locals of the current
+// frame which are not modified from loopStart on
+int isInvariantCode(CodeAddress loopStart, CodeAddress start, CodeAddress end) {
+  CodeAddress i;
+  Instruction* inst;
+
+  for (i = start; i < end; i ++) {
+    inst = codeBlock->code + i;
+    switch (inst->op) {
+    case OP_LC:
+    case OP_AD:
+    case OP_SB:
+    case OP_ML:
+    case OP_DV:
+    case OP_NEG:
+      break;
+    case OP_LV:
+      if ((inst->p != 0) || isModifiedIn(loopStart, inst->q)) return 0;
+      break;
+    default:
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// A word is inserted at slot in the stack under the code generated from
+// start on: the deeper temporaries and inlined frames move up
+void moveStackWords(CodeAddress start, WORD slot) {
+  CodeAddress i;
+  Instruction* inst;
+
+  for (i = start; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if (((inst->op == OP_LA) || (inst->op == OP_LV)) && (inst->p == 0) && (inst->q >= slot))
+      inst->q ++;
+  }
+}
+
+// Evaluate the invariant code [start, end) of the loop generated from 
+// loopStart once, before the loop, into a temporary pushed at the given
+// offset of the frame. The caller pops the temporary after the loop.
+// Returns the number of instructions added, 0 if the code is kept.
+int hoistInvariantCode(CodeAddress loopStart, CodeAddress start, CodeAddress end, WORD slot) {
+  int n = end - start;
+  Instruction* code;
+  Instruction* inst;
+  Instruction lv;
+  CodeAddress i;
+
+  // A single LC or LV costs as much as reading the temporary
+  if ((n < 2) || !isInvariantCode(loopStart, start, end)) return 0;
+
+  code = (Instruction*) malloc((n + 4) * sizeof(Instruction));
+  setInstruction(code, OP_INT, DC_VALUE, 1);
+  setInstruction(code + 1, OP_LA, 0, slot);
+  for (i = 0; i < n; i ++)
+    code[i + 2] = codeBlock->code[start + i];
+  setInstruction(code + n + 2, OP_ST, DC_VALUE, DC_VALUE);
+
+  moveStackWords(loopStart, slot);
+
+  setInstruction(&lv, OP_LV, 0, slot);
+  replaceCode(start, n, &lv, 1);
+  code[n + 3] = codeBlock->code[loopStart];
+  replaceCode(loopStart, 1, code, n + 4);
+  free(code);
+
+  // Jumps to the start of the loop now skip the evaluation
+  for (i = loopStart + n + 4; i < codeBlock->codeSize; i ++) {
+    inst = codeBlock->code + i;
+    if (isJumpInstruction(inst->op) && (inst->q == loopStart))
+      inst->q = loopStart + n + 3;
+  }
+
+  // INT, LA and ST are added, the code itself shrinks to one LV
+  return 4;
+}
+
+/******************* FOR loops ******************************/
+
+// Turn the FOR loop generated from varCode as
+//    lvalue  CV  from  ST CV LI  to  LE FJ  body  CV CV LI LC 1 AD ST CV LI J
+// (with JGT for LE FJ at -O1)
+// into
+//    lvalue  from  to  FI end  body  FS body
+// when the bound is invariant, as the fused loop does not evaluate it 
+// again. The body now runs with the bound on the stack, at slot in the 
+// frame. The loop ends at the current address. Returns 1 if done; the 
+// caller then pops both the address and the bound.
+int fuseForLoop(CodeAddress varCode, CodeAddress fromCode, CodeAddress toCode, CodeAddress toEnd, WORD slot) {
+  Instruction* code;
+  Instruction inst;
+  CodeAddress fi, i;
+  // LE FJ, or the fused JGT
+  int test = (codeBlock->code[toEnd].op == OP_LE) ? 2 : 1;
+
+  if (!isInvariantCode(varCode, toCode, toEnd)) return 0;
+
+  // The CV at slot is removed under the initial value: the frames inlined
+  // in it move down
+  for (i = fromCode; i < toCode - 3; i ++) {
+    code = codeBlock->code + i;
+    if (((code->op == OP_LA) || (code->op == OP_LV)) && (code->p == 0) && (code->q > slot))
+      code->q --;
+  }
+  moveStackWords(toEnd + test, slot);
+
+  setInstruction(&inst, OP_FS, DC_VALUE, DC_VALUE);
+  replaceCode(codeBlock->codeSize - 9, 9, &inst, 1);
+  setInstruction(&inst, OP_FI, DC_VALUE, DC_VALUE);
+  replaceCode(toEnd, test, &inst, 1);
+  replaceCode(toCode - 3, 3, NULL, 0);
+  replaceCode(fromCode - 1, 1, NULL, 0);
+
+  fi = toEnd - 4;
+  codeBlock->code[fi].q = codeBlock->codeSize;
+  codeBlock->code[codeBlock->codeSize - 1].q = fi + 1;
+  return 1;
+}
+
+/******************* Dead variables ******************************/
+
+// How the words of a frame are used
+#define USE_STORE 1
+#define USE_READ 2
+#define USE_DEAD 4
+
+// Stores to a dead variable
+struct DeadStore_ {
+  CodeAddress address;   // the LA
+  CodeAddress store;     // the ST
+  int pure;              // can the stored value be dropped
+};
+
+typedef struct DeadStore_ DeadStore;
+
+// An instruction reading the top of the stack, or the two top words
+int readsTop(enum OpCode op, int count) {
+  switch (op) {
+  case OP_LA:
+  case OP_LV:
+  case OP_LC:
+  case OP_INT:
+  case OP_RC:
+  case OP_RI:
+  case OP_CALL:
+    return 0;
+  case OP_LI:
+  case OP_NEG:
+  case OP_BC:
+    return (count == 1);
+  default:
+    return 1;
+  }
+}
+
+// Is the address pushed at inst only used by an ST storing the value
+// computed right above it? Return the ST or -1.
+CodeAddress getStoreOf(CodeAddress inst, CodeAddress bodyAddress, CodeAddress end, int* depths) {
+  int depth = depths[inst - bodyAddress];
+  CodeAddress i;
+  int d;
+
+  for (i = inst + 1; i < end; i ++) {
+    d = depths[i - bodyAddress];
+    if (d == UNKNOWN_DEPTH) return -1;
+    if (d == depth + 2 && codeBlock->code[i].op == OP_ST) return i;
+    if (d == depth + 1 && readsTop(codeBlock->code[i].op, 1)) return -1;
+    if (d == depth + 2 && readsTop(codeBlock->code[i].op, 2)) return -1;
+    if (d <= depth) return -1;
+  }
+  return -1;
+}
+
+// Can the value computed between the address and the ST be dropped?
+int isPureCode(CodeAddress start, CodeAddress end) {
+  CodeAddress i;
+
+  for (i = start; i < end; i ++) {
+    switch (codeBlock->code[i].op) {
+    case OP_LA:
+    case OP_LV:
+    case OP_LC:
+    case OP_LI:
+    case OP_AD:
+    case OP_SB:
+    case OP_ML:
+    case OP_NEG:
+    case OP_CV:
+    case OP_EQ:
+    case OP_NE:
+    case OP_GT:
+    case OP_LT:
+    case OP_GE:
+    case OP_LE:
+      break;
+    default:
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Record how the words of the frame are used by a body at the given
+// level below the frame owner, with the stores to be removed if dead
+void scanFrameUses(CodeAddress bodyAddress, CodeAddress end, int level, 
+		   int frameSize, int* uses, DeadStore* stores, int* storeCount) {
+  int* depths = computeStackDepths(bodyAddress, end);
+  Instruction* inst;
+  CodeAddress i, st;
+
+  for (i = bodyAddress + 1; i < end; i ++) {
+    inst = codeBlock->code + i;
+    if ((inst->p != level) || (inst->q >= frameSize)) continue;
+
+    if (inst->op == OP_LV)
+      uses[inst->q] |= USE_READ;
+    else if (inst->op == OP_LA) {
+      st = getStoreOf(i, bodyAddress, end, depths);
+      if (st < 0) 
+	uses[inst->q] |= USE_READ;
+      else {
+	uses[inst->q] |= USE_STORE;
+	stores[*storeCount].address = i;
+	stores[*storeCount].store = st;
+	// The current body may be shortened, not the nested ones
+	stores[*storeCount].pure = (level == 0) && isPureCode(i + 1, st);
+	(*storeCount) ++;
+      }
+    }
+  }
+  free(depths);
+}
+
+// Nested subprograms come before the body of the scope
+void scanNestedFrameUses(Scope* scope, int level, int frameSize, 
+			 int* uses, DeadStore* stores, int* storeCount) {
+  ObjectNode* node;
+  Object* obj;
+  Scope* subScope;
+  CodeAddress bodyAddress;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION) {
+      bodyAddress = codeBlock->code[obj->funcAttrs->codeAddress].q;
+      subScope = obj->funcAttrs->scope;
+    } else if (obj->kind == OBJ_PROCEDURE) {
+      bodyAddress = codeBlock->code[obj->procAttrs->codeAddress].q;
+      subScope = obj->procAttrs->scope;
+    } else continue;
+
+    scanFrameUses(bodyAddress, getBodyEnd(bodyAddress), level, frameSize, uses, stores, storeCount);
+    scanNestedFrameUses(subScope, level + 1, frameSize, uses, stores, storeCount);
+  }
+}
+
+// Move the references to the frame in a body at the given level
+void moveFrameReferences(CodeAddress bodyAddress, CodeAddress end, int level, int* shifts, int frameSize) {
+  Instruction* inst;
+  CodeAddress i;
+
+  for (i = bodyAddress + 1; i < end; i ++) {
+    inst = codeBlock->code + i;
+    if (((inst->op == OP_LA) || (inst->op == OP_LV)) && (inst->p == level))
+      inst->q -= (inst->q < frameSize) ? shifts[inst->q] : shifts[frameSize];
+  }
+}
+
+void moveNestedFrameReferences(Scope* scope, int level, int* shifts, int frameSize) {
+  ObjectNode* node;
+  Object* obj;
+  Scope* subScope;
+  CodeAddress bodyAddress;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION) {
+      bodyAddress = codeBlock->code[obj->funcAttrs->codeAddress].q;
+      subScope = obj->funcAttrs->scope;
+    } else if (obj->kind == OBJ_PROCEDURE) {
+      bodyAddress = codeBlock->code[obj->procAttrs->codeAddress].q;
+      subScope = obj->procAttrs->scope;
+    } else continue;
+
+    moveFrameReferences(bodyAddress, getBodyEnd(bodyAddress), level, shifts, frameSize);
+    moveNestedFrameReferences(subScope, level + 1, shifts, frameSize);
+  }
+}
+
+// Remove the variables of the scope which are never read, and the stores 
+// to them, then compact the frame. The body of the scope has just been 
+// generated from bodyAddress. Nothing but stores may use a dead variable: 
+// its address must not be taken (arrays, VAR arguments, FOR).
+void removeDeadVariables(Scope* scope, CodeAddress bodyAddress) {
+  int frameSize = scope->frameSize;
+  int* uses = (int*) calloc(frameSize, sizeof(int));
+  int* shifts = (int*) malloc((frameSize + 1) * sizeof(int));
+  DeadStore* stores = (DeadStore*) malloc((codeBlock->codeSize + 1) * sizeof(DeadStore));
+  int storeCount = 0;
+  ObjectNode* node;
+  Object* var;
+  Instruction* inst;
+  int offset, size, i;
+
+  scanFrameUses(bodyAddress, codeBlock->codeSize, 0, frameSize, uses, stores, &storeCount);
+  scanNestedFrameUses(scope, 1, frameSize, uses, stores, &storeCount);
+
+  // shifts[o]: number of dead words below the offset o
+  for (offset = 0; offset <= frameSize; offset ++) shifts[offset] = 0;
+  for (node = scope->objList; node != NULL; node = node->next) {
+    var = node->object;
+    if ((var->kind != OBJ_VARIABLE) || (uses[var->varAttrs->localOffset] & USE_READ)) 
+      continue;
+    size = sizeOfType(var->varAttrs->type);
+    uses[var->varAttrs->localOffset] |= USE_DEAD;
+    for (offset = var->varAttrs->localOffset + size; offset <= frameSize; offset ++)
+      shifts[offset] += size;
+  }
+
+  if (shifts[frameSize] > 0) {
+    // Drop the stored values, keeping the stack depth in the nested bodies
+    for (i = 0; i < storeCount; i ++) {
+      if (!(uses[codeBlock->code[stores[i].address].q] & USE_DEAD)) 
+	stores[i].address = -1;
+      else if (!stores[i].pure) {
+	inst = codeBlock->code + stores[i].address;
+	inst->op = OP_LC;
+	inst->p = DC_VALUE;
+	inst->q = 0;
+	inst = codeBlock->code + stores[i].store;
+	inst->op = OP_DCT;
+	inst->q = 2;
+      }
+    }
+    for (i = storeCount - 1; i >= 0; i --) 
+      if ((stores[i].address >= 0) && stores[i].pure)
+	replaceCode(stores[i].address, stores[i].store + 1 - stores[i].address, NULL, 0);
+
+    moveFrameReferences(bodyAddress, codeBlock->codeSize, 0, shifts, frameSize);
+    moveNestedFrameReferences(scope, 1, shifts, frameSize);
+    codeBlock->code[bodyAddress].q -= shifts[frameSize];
+
+    for (node = scope->objList; node != NULL; node = node->next) {
+      var = node->object;
+      if (var->kind == OBJ_VARIABLE)
+	var->varAttrs->localOffset -= shifts[var->varAttrs->localOffset];
+    }
+    scope->frameSize -= shifts[frameSize];
+  }
+
+  free(uses);
+  free(shifts);
+  free(stores);
+}
@@ -0,0 +1,51 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include <limits.h>
+#include "instructions.h"
+#include "symtab.h"
+
+// Depth of the unreachable code
+#define UNKNOWN_DEPTH INT_MIN
+
+// Maximum number of instructions in the body of an inlined subprogram
+#define INLINE_THRESHOLD 16
+
+// A self call in tail position
+struct TailCall_ {
+  CodeAddress start;     // first instruction of the statement
+  CodeAddress end;       // after the last instruction of the statement
+  CodeAddress args;      // first instruction computing the arguments
+  CodeAddress argsEnd;   // the DCT following the arguments
+  int argsDepth;         // words pushed by the statement before the arguments
+  int argCount;
+};
+
+typedef struct TailCall_ TailCall;
+
+void removeSafeBoundsChecks(Instruction* loopVar, WORD low, WORD high, CodeAddress bodyStart);
+
+int getStackDepth(CodeAddress bodyAddress, CodeAddress address);
+CodeAddress getBodyEnd(CodeAddress bodyAddress);
+int isInlinable(CodeAddress codeAddress);
+void inlineBody(CodeAddress codeAddress, int level, WORD frameBase, int argWords);
+
+int* computeStackDepths(CodeAddress bodyAddress, CodeAddress address);
+int findTailCall(CodeAddress codeAddress, CodeAddress bodyAddress, CodeAddress end, TailCall* tailCall);
+void eliminateTailCalls(CodeAddress codeAddress);
+
+void moveStackWords(CodeAddress start, WORD slot);
+int isInvariantCode(CodeAddress loopStart, CodeAddress start, CodeAddress end);
+int hoistInvariantCode(CodeAddress loopStart, CodeAddress start, CodeAddress end, WORD slot);
+
+int fuseForLoop(CodeAddress varCode, CodeAddress fromCode, CodeAddress toCode, CodeAddress toEnd, WORD slot);
+
+void removeDeadVariables(Scope* scope, CodeAddress bodyAddress);
+
+#endif
@@ -0,0 +1,170 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "codegen.h"
+#include "astgen.h"
+#include "pargen.h"
+
+extern __thread SymTab* symtab;
+
+// The subprograms, numbered in the order of the tree
+Subprogram* subprograms;
+int subprogramCount;
+int nextSubprogram;
+pthread_mutex_t subprogramLock = PTHREAD_MUTEX_INITIALIZER;
+
+SymTab* sharedSymtab;
+
+// Until it is linked, a subprogram is called at -(number + 1), after the
+// addresses of the subprograms of other units
+void collectSubprograms(AstIndex node) {
+  Object* obj = getAstNode(node)->object;
+  AstIndex child;
+
+  subprograms[subprogramCount].node = node;
+  subprograms[subprogramCount].code = NULL;
+  subprogramCount ++;
+  if (obj->kind == OBJ_FUNCTION)
+    obj->funcAttrs->codeAddress = - getExternalCount() - subprogramCount;
+  else if (obj->kind == OBJ_PROCEDURE)
+    obj->procAttrs->codeAddress = - getExternalCount() - subprogramCount;
+
+  for (child = getAstNode(getAstNode(node)->child)->child; child != AST_NONE; child = getAstNode(child)->sibling)
+    if ((getAstNode(child)->kind == AST_FUNCTION) || (getAstNode(child)->kind == AST_PROCEDURE))
+      collectSubprograms(child);
+}
+
+int takeSubprogram(void) {
+  int number;
+
+  pthread_mutex_lock(&subprogramLock);
+  number = nextSubprogram ++;
+  pthread_mutex_unlock(&subprogramLock);
+  return number;
+}
+
+// Generate subprograms until none is left, each in its own buffer and
+// with its own current scope
+void* generateSubprograms(void* arg) {
+  SymTab* savedSymtab = symtab;
+  CodeBlock* savedBlock = switchCodeBuffer(NULL);
+  SymTab table = *sharedSymtab;
+  Subprogram* sub;
+  int number;
+
+  symtab = &table;
+  while ((number = takeSubprogram()) < subprogramCount) {
+    sub = subprograms + number;
+    sub->code = createCodeBuffer();
+    switchCodeBuffer(sub->code);
+
+    switch (getAstNode(sub->node)->kind) {
+    case AST_FUNCTION:
+      genFunctionNode(sub->node);
+      break;
+    case AST_PROCEDURE:
+      genProcedureNode(sub->node);
+      break;
+    default:
+      genProgramNode(sub->node);
+      break;
+    }
+  }
+
+  symtab = savedSymtab;
+  switchCodeBuffer(savedBlock);
+  return NULL;
+}
+
+// Copy the subprogram from the current address, with its nested ones
+// between its first jump and its body, as they are generated in one
+// buffer. Returns the number of the subprogram following the nested ones.
+int linkSubprogram(int number) {
+  Subprogram* sub = subprograms + number;
+  CodeBlock* code = sub->code;
+  Instruction* inst;
+  CodeAddress bodyShift;
+  AstIndex child;
+  int next = number + 1;
+  WORD q;
+  int i;
+
+  sub->address = getCurrentCodeAddress();
+  genInstruction(code->code[0].op, code->code[0].p, code->code[0].q);
+
+  for (child = getAstNode(getAstNode(sub->node)->child)->child; child != AST_NONE; child = getAstNode(child)->sibling)
+    if ((getAstNode(child)->kind == AST_FUNCTION) || (getAstNode(child)->kind == AST_PROCEDURE))
+      next = linkSubprogram(next);
+
+  // The body is generated from address 1, after the first jump
+  bodyShift = getCurrentCodeAddress() - 1;
+  if (sub->address < getCurrentCodeAddress())
+    updateJ(sub->address, code->code[0].q + bodyShift);
+
+  for (i = 1; i < code->codeSize; i ++) {
+    inst = code->code + i;
+    q = inst->q;
+    if (isBranchInstruction(inst->op))
+      q = (q == 0) ? sub->address : q + bodyShift;
+    genInstruction(inst->op, inst->p, q);
+  }
+  return next;
+}
+
+void relocateCalls(void) {
+  Instruction* inst;
+  Object* obj;
+  CodeAddress i;
+  int number;
+
+  for (i = 0; i < getCurrentCodeAddress(); i ++) {
+    inst = getInstruction(i);
+    if ((inst->op == OP_CALL) && (inst->q < - getExternalCount()))
+      inst->q = subprograms[- inst->q - getExternalCount() - 1].address;
+  }
+
+  for (number = 0; number < subprogramCount; number ++) {
+    obj = getAstNode(subprograms[number].node)->object;
+    if (obj->kind == OBJ_FUNCTION)
+      obj->funcAttrs->codeAddress = subprograms[number].address;
+    else if (obj->kind == OBJ_PROCEDURE)
+      obj->procAttrs->codeAddress = subprograms[number].address;
+    else obj->progAttrs->codeAddress = subprograms[number].address;
+    freeCodeBlock(subprograms[number].code);
+  }
+}
+
+// The subprograms share nothing but the tree and the symbol table, which
+// are only read. The calling thread works with threadCount - 1 others.
+void genProgramInParallel(AstIndex program, int threadCount) {
+  pthread_t* threads = (pthread_t*) malloc(threadCount * sizeof(pthread_t));
+  int started = 0;
+  int i;
+
+  subprograms = (Subprogram*) malloc(countAstNodes() * sizeof(Subprogram));
+  subprogramCount = 0;
+  nextSubprogram = 0;
+  collectSubprograms(program);
+
+  sharedSymtab = symtab;
+  separateSubprograms = 1;
+  for (i = 1; i < threadCount; i ++)
+    if (pthread_create(threads + started, NULL, generateSubprograms, NULL) == 0)
+      started ++;
+  generateSubprograms(NULL);
+  for (i = 0; i < started; i ++)
+    pthread_join(threads[i], NULL);
+  separateSubprograms = 0;
+
+  linkSubprogram(0);
+  relocateCalls();
+
+  free(subprograms);
+  free(threads);
+}
@@ -0,0 +1,24 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PARGEN_H__
+#define __PARGEN_H__
+
+#include "ast.h"
+#include "instructions.h"
+
+// The program, a function or a procedure, generated in its own buffer
+struct Subprogram_ {
+  AstIndex node;
+  CodeBlock* code;
+  CodeAddress address;   // where it is linked
+};
+
+typedef struct Subprogram_ Subprogram;
+
+void genProgramInParallel(AstIndex program, int threadCount);
+
+#endif
@@ -5,6 +5,8 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 #include "reader.h"
 #include "scanner.h"
@@ -13,18 +15,40 @@
 #include "error.h"
 #include "debug.h"
 #include "codegen.h"
+#include "astgen.h"
+#include "optimizer.h"
+#include "stats.h"
+#include "interface.h"
+#include "xref.h"
 
 Token *currentToken;
 Token *lookAhead;
 
 extern Type* intType;
 extern Type* charType;
-extern SymTab* symtab;
+extern __thread SymTab* symtab;
+extern int boundsCheck;
+extern int optimizationLevel;
+
+#define MAX_UNITS 64
+
+// The file read, units are searched in its directory
+char* sourceFileName;
+
+// Each unit is imported once
+char usedUnits[MAX_UNITS][MAX_IDENT_LEN + 1];
+int usedUnitCount = 0;
+
+// kplc --lsp parses the tokens it keeps instead of scanning the input
+Token* (*readToken)(void) = getValidToken;
+
+// The bodies are skipped when only the declarations are needed
+int skipBodies = 0;
 
 void scan(void) {
   Token* tmp = currentToken;
   currentToken = lookAhead;
-  lookAhead = getValidToken();
+  lookAhead = readToken();
   free(tmp);
 }
 
@@ -35,6 +59,13 @@ void eat(TokenType tokenType) {
   } else missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
 }
 
+// The object is declared by the name just read
+void locateObject(Object* obj) {
+  obj->lineNo = currentToken->lineNo;
+  obj->colNo = currentToken->colNo;
+  indexDefinition(obj);
+}
+
 void compileProgram(void) {
   Object* program;
 
@@ -42,10 +73,12 @@ void compileProgram(void) {
   eat(TK_IDENT);
 
   program = createProgramObject(currentToken->string);
+  locateObject(program);
   program->progAttrs->codeAddress = getCurrentCodeAddress();
   enterBlock(program->progAttrs->scope);
 
   eat(SB_SEMICOLON);
+  compileUses();
 
   compileBlock();
   eat(SB_PERIOD);
@@ -56,6 +89,163 @@ void compileProgram(void) {
   exitBlock();
 }
 
+// A unit has no variables and no body: its subprograms are generated 
+// from address 0, and called by the program it is linked with
+Object* compileUnit(void) {
+  Object* unit;
+
+  eat(KW_UNIT);
+  eat(TK_IDENT);
+
+  unit = createProgramObject(currentToken->string);
+  locateObject(unit);
+  useUnit(currentToken->string);
+  enterBlock(unit->progAttrs->scope);
+
+  eat(SB_SEMICOLON);
+  compileUses();
+
+  compileConstDecls();
+  compileTypeDecls();
+  compileSubDecls();
+  eat(SB_PERIOD);
+
+  exitBlock();
+  return unit;
+}
+
+void compileUses(void) {
+  if (lookAhead->tokenType == KW_USES) {
+    eat(KW_USES);
+    eat(TK_IDENT);
+    importUnit(currentToken->string);
+    while (lookAhead->tokenType == SB_COMMA) {
+      eat(SB_COMMA);
+      eat(TK_IDENT);
+      importUnit(currentToken->string);
+    }
+    eat(SB_SEMICOLON);
+  }
+}
+
+// Returns 0 if the unit is already used
+int useUnit(char* name) {
+  int i;
+
+  for (i = 0; i < usedUnitCount; i ++)
+    if (strcmp(usedUnits[i], name) == 0)
+      return 0;
+  if (usedUnitCount < MAX_UNITS)
+    strcpy(usedUnits[usedUnitCount ++], name);
+  return 1;
+}
+
+// name and the extension in lower case, in the directory of the file read
+char* getUnitFileName(char* name, char* extension) {
+  char* slash = strrchr(sourceFileName, '/');
+  int length = (slash == NULL) ? 0 : slash - sourceFileName + 1;
+  char* fileName = (char*) malloc(length + strlen(name) + strlen(extension) + 1);
+  int i;
+
+  strncpy(fileName, sourceFileName, length);
+  for (i = 0; name[i] != '\0'; i ++)
+    fileName[length + i] = tolower(name[i]);
+  strcpy(fileName + length + i, extension);
+  return fileName;
+}
+
+// Compile the source of a unit used, only for its declarations. Its bodies
+// are skipped, its code is generated apart and dropped.
+Object* compileUnitSource(char* fileName, int lineNo, int colNo) {
+  Token* savedToken = currentToken;
+  Token* savedLookAhead = lookAhead;
+  char* savedFileName = sourceFileName;
+  Scope* savedScope = symtab->currentScope;
+  Object* savedProgram = symtab->program;
+  Token* (*savedReader)(void) = readToken;
+  int savedSkip = skipBodies;
+  int savedIndexing = indexing;
+  InputPosition position;
+  CodeBlock* savedBlock;
+  Object* unit;
+
+  saveInputStream(&position);
+  if (openInputStream(fileName) == IO_ERROR)
+    error(ERR_UNDECLARED_UNIT, lineNo, colNo);
+
+  sourceFileName = fileName;
+  readToken = getValidToken;
+  skipBodies = 1;
+  indexing = 0;
+  currentToken = NULL;
+  lookAhead = readToken();
+  savedBlock = switchCodeBuffer(createCodeBuffer());
+  symtab->currentScope = NULL;
+
+  unit = compileUnit();
+
+  freeCodeBlock(switchCodeBuffer(savedBlock));
+  closeInputStream();
+  free(currentToken);
+  free(lookAhead);
+
+  restoreInputStream(&position);
+  currentToken = savedToken;
+  lookAhead = savedLookAhead;
+  sourceFileName = savedFileName;
+  symtab->currentScope = savedScope;
+  symtab->program = savedProgram;
+  readToken = savedReader;
+  skipBodies = savedSkip;
+  indexing = savedIndexing;
+  return unit;
+}
+
+// Declare what the unit exports as global objects, from its interface 
+// if it is up to date, or else from its source. Its subprograms are 
+// called at the addresses kpllink gives them.
+void importUnit(char* name) {
+  int lineNo = currentToken->lineNo;
+  int colNo = currentToken->colNo;
+  char* sourceName;
+  char* interfaceName;
+  ObjectNode* node;
+  Object* unit = NULL;
+
+  if (!useUnit(name)) return;
+
+  sourceName = getUnitFileName(name, ".kpl");
+  interfaceName = getUnitFileName(name, ".kpi");
+  if (isInterfaceUpToDate(interfaceName, sourceName))
+    unit = loadInterface(interfaceName);
+  if (unit == NULL)
+    unit = compileUnitSource(sourceName, lineNo, colNo);
+  free(sourceName);
+  free(interfaceName);
+
+  for (node = unit->progAttrs->scope->objList; node != NULL; node = node->next) {
+    if (findObject(symtab->globalObjectList, node->object->name) != NULL)
+      error(ERR_DUPLICATE_IDENT, lineNo, colNo);
+    if (node->object->kind == OBJ_FUNCTION)
+      node->object->funcAttrs->codeAddress = declareExternal(node->object->name);
+    else if (node->object->kind == OBJ_PROCEDURE)
+      node->object->procAttrs->codeAddress = declareExternal(node->object->name);
+  }
+  importObjects(unit);
+}
+
+// The unit compiled exports its subprograms, and saves its declarations
+// in name.kpi for the units and programs using it
+void compileUnitFile(void) {
+  Object* unit = compileUnit();
+  char* interfaceName = getUnitFileName(unit->name, ".kpi");
+
+  declareExports(unit->progAttrs->scope);
+  if (saveInterface(interfaceName, unit, usedUnits + 1, usedUnitCount - 1) == IO_ERROR)
+    printf("Can\'t write interface file %s!\n", interfaceName);
+  free(interfaceName);
+}
+
 void compileConstDecls(void) {
   Object* constObj;
   ConstantValue* constValue;
@@ -66,6 +256,7 @@ void compileConstDecls(void) {
       eat(TK_IDENT);
       checkFreshIdent(currentToken->string);
       constObj = createConstantObject(currentToken->string);
+      locateObject(constObj);
       declareObject(constObj);
       
       eat(SB_EQ);
@@ -88,6 +279,7 @@ void compileTypeDecls(void) {
       
       checkFreshIdent(currentToken->string);
       typeObj = createTypeObject(currentToken->string);
+      locateObject(typeObj);
       declareObject(typeObj);
       
       eat(SB_EQ);
@@ -109,6 +301,7 @@ void compileVarDecls(void) {
       eat(TK_IDENT);
       checkFreshIdent(currentToken->string);
       varObj = createVariableObject(currentToken->string);
+      locateObject(varObj);
       eat(SB_COLON);
       varType = compileType();
       varObj->varAttrs->type = varType;
@@ -119,7 +312,9 @@ void compileVarDecls(void) {
 }
 
 void compileBlock(void) {
-  Instruction* jmp;
+  CodeAddress jmp;
+  CodeAddress bodyAddress;
+  AstIndex body;
   // Jump to the body of the block
   jmp = genJ(DC_VALUE);
 
@@ -129,12 +324,48 @@ void compileBlock(void) {
   compileSubDecls();
 
   // Update the jmp label
-  updateJ(jmp,getCurrentCodeAddress());
+  bodyAddress = getCurrentCodeAddress();
+  updateJ(jmp, bodyAddress);
   // Skip the stack frame
   genINT(symtab->currentScope->frameSize);
 
+  if (skipBodies) {
+    skipBlockBody();
+    return;
+  }
+
   eat(KW_BEGIN);
-  compileStatements();
+  body = createAstNode(AST_GROUP);
+  buildStatements(body);
+  eat(KW_END);
+
+  // The body is generated as soon as it is parsed, then its nodes dropped
+  enterPhase(PHASE_CODEGEN);
+  genStatementNode(body);
+  leavePhase();
+  dropAstNodes(body);
+
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    removeDeadVariables(symtab->currentScope, bodyAddress);
+    leavePhase();
+  }
+}
+
+// The body is read without being parsed, and its bytes are kept in 
+// the scope
+void skipBlockBody(void) {
+  Scope* scope = symtab->currentScope;
+  Token* tmp = currentToken;
+
+  if (lookAhead->tokenType != KW_BEGIN)
+    missingToken(KW_BEGIN, lookAhead->lineNo, lookAhead->colNo);
+  // The scanner stopped after BEGIN
+  scope->bodyStart = getInputOffset() - 5;
+  currentToken = lookAhead;
+  lookAhead = skipBody();
+  free(tmp);
+  scope->bodyEnd = getInputOffset();
   eat(KW_END);
 }
 
@@ -146,7 +377,8 @@ void compileSubDecls(void) {
   }
 }
 
-void compileFuncDecl(void) {
+// The function is declared and its block entered, up to its declarations
+Object* compileFuncHeader(void) {
   Object* funcObj;
   Type* returnType;
 
@@ -155,7 +387,7 @@ void compileFuncDecl(void) {
 
   checkFreshIdent(currentToken->string);
   funcObj = createFunctionObject(currentToken->string);
-  funcObj->funcAttrs->codeAddress = getCurrentCodeAddress();
+  locateObject(funcObj);
   declareObject(funcObj);
 
   enterBlock(funcObj->funcAttrs->scope);
@@ -167,15 +399,10 @@ void compileFuncDecl(void) {
   funcObj->funcAttrs->returnType = returnType;
 
   eat(SB_SEMICOLON);
-
-  compileBlock();
-
-  eat(SB_SEMICOLON);
-
-  exitBlock();
+  return funcObj;
 }
 
-void compileProcDecl(void) {
+Object* compileProcHeader(void) {
   Object* procObj;
 
   eat(KW_PROCEDURE);
@@ -183,7 +410,7 @@ void compileProcDecl(void) {
 
   checkFreshIdent(currentToken->string);
   procObj = createProcedureObject(currentToken->string);
-  procObj->procAttrs->codeAddress = getCurrentCodeAddress();
+  locateObject(procObj);
   declareObject(procObj);
 
   enterBlock(procObj->procAttrs->scope);
@@ -191,7 +418,37 @@ void compileProcDecl(void) {
   compileParams();
 
   eat(SB_SEMICOLON);
+  return procObj;
+}
+
+void compileFuncDecl(void) {
+  Object* funcObj = compileFuncHeader();
+
+  funcObj->funcAttrs->codeAddress = getCurrentCodeAddress();
   compileBlock();
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    eliminateTailCalls(funcObj->funcAttrs->codeAddress);
+    leavePhase();
+  }
+  genEF();
+
+  eat(SB_SEMICOLON);
+
+  exitBlock();
+}
+
+void compileProcDecl(void) {
+  Object* procObj = compileProcHeader();
+
+  procObj->procAttrs->codeAddress = getCurrentCodeAddress();
+  compileBlock();
+  if (optimizationLevel >= 1) {
+    enterPhase(PHASE_OPTIMIZER);
+    eliminateTailCalls(procObj->procAttrs->codeAddress);
+    leavePhase();
+  }
+  genEP();
 
   eat(SB_SEMICOLON);
 
@@ -356,218 +613,187 @@ void compileParam(void) {
   eat(TK_IDENT);
   checkFreshIdent(currentToken->string);
   param = createParameterObject(currentToken->string, paramKind);
+  locateObject(param);
   eat(SB_COLON);
   type = compileBasicType();
   param->paramAttrs->type = type;
   declareObject(param);
 }
 
-void compileStatements(void) {
-  compileStatement();
+void buildStatements(AstIndex group) {
+  addAstChild(group, buildStatement());
   while (lookAhead->tokenType == SB_SEMICOLON) {
     eat(SB_SEMICOLON);
-    compileStatement();
+    addAstChild(group, buildStatement());
   }
 }
 
-void compileStatement(void) {
+AstIndex buildStatement(void) {
+  AstIndex node = AST_NONE;
+
   switch (lookAhead->tokenType) {
   case TK_IDENT:
-    compileAssignSt();
+    node = buildAssignSt();
     break;
   case KW_CALL:
-    compileCallSt();
+    node = buildCallSt();
     break;
   case KW_BEGIN:
-    compileGroupSt();
+    node = buildGroupSt();
     break;
   case KW_IF:
-    compileIfSt();
+    node = buildIfSt();
     break;
   case KW_WHILE:
-    compileWhileSt();
+    node = buildWhileSt();
     break;
   case KW_FOR:
-    compileForSt();
+    node = buildForSt();
     break;
     // EmptySt needs to check FOLLOW tokens
   case SB_SEMICOLON:
   case KW_END:
   case KW_ELSE:
+    node = createAstNode(AST_EMPTY);
     break;
     // Error occurs
   default:
     error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
     break;
   }
+  return node;
 }
 
-Type* compileLValue(void) {
+AstIndex buildLValue(Type** type) {
   Object* var;
-  Type* varType;
+  AstIndex node = AST_NONE;
 
   eat(TK_IDENT);
-  
+
   var = checkDeclaredLValueIdent(currentToken->string);
 
   switch (var->kind) {
   case OBJ_VARIABLE:
-    genVariableAddress(var);
-
     if (var->varAttrs->type->typeClass == TP_ARRAY) {
-      varType = compileIndexes(var->varAttrs->type);
+      node = createObjectNode(AST_ELEMENT, var);
+      *type = buildIndexes(node, var->varAttrs->type);
+    } else {
+      node = createObjectNode(AST_VARIABLE, var);
+      *type = var->varAttrs->type;
     }
-    else
-      varType = var->varAttrs->type;
     break;
   case OBJ_PARAMETER:
-    if (var->paramAttrs->kind == PARAM_VALUE)
-      genParameterAddress(var);
-    else genParameterValue(var);
-
-    varType = var->paramAttrs->type;
+    node = createObjectNode(AST_PARAMETER, var);
+    *type = var->paramAttrs->type;
     break;
   case OBJ_FUNCTION:
-    genReturnValueAddress(var);
-    varType = var->funcAttrs->returnType;
+    node = createObjectNode(AST_RETURN_VALUE, var);
+    *type = var->funcAttrs->returnType;
     break;
-  default: 
+  default:
     error(ERR_INVALID_LVALUE,currentToken->lineNo, currentToken->colNo);
   }
 
-  return varType;
+  return node;
 }
 
-void compileAssignSt(void) {
+AstIndex buildAssignSt(void) {
   Type* varType;
   Type* expType;
+  AstIndex node = createAstNode(AST_ASSIGN);
+
+  addAstChild(node, buildLValue(&varType));
 
-  varType = compileLValue();
-  
   eat(SB_ASSIGN);
-  expType = compileExpression();
+  addAstChild(node, buildExpression(&expType));
   checkTypeEquality(varType, expType);
 
-  genST();
+  return node;
 }
 
-void compileCallSt(void) {
-  // Generate code for call-statement
-  // TEMPORARY. halt
+AstIndex buildCallSt(void) {
   Object* proc;
+  AstIndex node;
 
   eat(KW_CALL);
   eat(TK_IDENT);
 
   proc = checkDeclaredProcedure(currentToken->string);
 
-  if (isPredefinedProcedure(proc)) {
-    compileArguments(proc->procAttrs->paramList);
-    genPredefinedProcedureCall(proc);
-  } else {
-    compileArguments(proc->procAttrs->paramList);
-    genHL();
-  }
+  node = createObjectNode(AST_CALL, proc);
+  buildArguments(proc->procAttrs->paramList, node);
+  return node;
 }
 
-void compileGroupSt(void) {
+AstIndex buildGroupSt(void) {
+  AstIndex node = createAstNode(AST_GROUP);
+
   eat(KW_BEGIN);
-  compileStatements();
+  buildStatements(node);
   eat(KW_END);
+  return node;
 }
 
-void compileIfSt(void) {
-  Instruction* fjInstruction;
-  Instruction* jInstruction;
+AstIndex buildIfSt(void) {
+  AstIndex node = createAstNode(AST_IF);
 
   eat(KW_IF);
-  compileCondition();
+  addAstChild(node, buildCondition());
   eat(KW_THEN);
 
-  fjInstruction = genFJ(DC_VALUE);
-  compileStatement();
+  addAstChild(node, buildStatement());
   if (lookAhead->tokenType == KW_ELSE) {
-    jInstruction = genJ(DC_VALUE);
-    updateFJ(fjInstruction, getCurrentCodeAddress());
     eat(KW_ELSE);
-    compileStatement();
-    updateJ(jInstruction, getCurrentCodeAddress());
-  } else {
-    updateFJ(fjInstruction, getCurrentCodeAddress());
+    addAstChild(node, buildStatement());
   }
+  return node;
 }
 
-void compileWhileSt(void) {
-  CodeAddress beginWhile;
-  Instruction* fjInstruction;
+AstIndex buildWhileSt(void) {
+  AstIndex node = createAstNode(AST_WHILE);
 
-  beginWhile = getCurrentCodeAddress();
   eat(KW_WHILE);
-  compileCondition();
-  fjInstruction = genFJ(DC_VALUE);
+  addAstChild(node, buildCondition());
   eat(KW_DO);
-  compileStatement();
-  genJ(beginWhile);
-  updateFJ(fjInstruction, getCurrentCodeAddress());
+  addAstChild(node, buildStatement());
+  return node;
 }
 
-void compileForSt(void) {
-  CodeAddress beginLoop;
-  Instruction* fjInstruction;
+AstIndex buildForSt(void) {
   Type* varType;
   Type *type;
+  AstIndex node = createAstNode(AST_FOR);
 
   eat(KW_FOR);
 
-  varType = compileLValue();
+  addAstChild(node, buildLValue(&varType));
   eat(SB_ASSIGN);
 
-  genCV();
-  type = compileExpression();
+  addAstChild(node, buildExpression(&type));
   checkTypeEquality(varType, type);
-  genST();
-  genCV();
-  genLI();
-  beginLoop = getCurrentCodeAddress();
   eat(KW_TO);
 
-  type = compileExpression();
+  addAstChild(node, buildExpression(&type));
   checkTypeEquality(varType, type);
-  genLE();
-  fjInstruction = genFJ(DC_VALUE);
 
   eat(KW_DO);
-  compileStatement();
-
-  genCV();  
-  genCV();
-  genLI();
-  genLC(1);
-  genAD();
-  genST();
-
-  genCV();
-  genLI();
-
-  genJ(beginLoop);
-  updateFJ(fjInstruction, getCurrentCodeAddress());
-  genDCT(1);
-
+  addAstChild(node, buildStatement());
+  return node;
 }
 
-void compileArgument(Object* param) {
+void buildArgument(Object* param, AstIndex call) {
   Type* type;
 
   if (param->paramAttrs->kind == PARAM_VALUE) {
-    type = compileExpression();
+    addAstChild(call, buildExpression(&type));
     checkTypeEquality(type, param->paramAttrs->type);
   } else {
-    type = compileLValue();
+    addAstChild(call, buildLValue(&type));
     checkTypeEquality(type, param->paramAttrs->type);
   }
 }
 
-void compileArguments(ObjectNode* paramList) {
+void buildArguments(ObjectNode* paramList, AstIndex call) {
   ObjectNode* node = paramList;
 
   switch (lookAhead->tokenType) {
@@ -575,23 +801,23 @@ void compileArguments(ObjectNode* paramList) {
     eat(SB_LPAR);
     if (node == NULL)
       error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-    compileArgument(node->object);
+    buildArgument(node->object, call);
     node = node->next;
 
     while (lookAhead->tokenType == SB_COMMA) {
       eat(SB_COMMA);
       if (node == NULL)
 	error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-      compileArgument(node->object);
+      buildArgument(node->object, call);
       node = node->next;
     }
 
     if (node != NULL)
       error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-    
+
     eat(SB_RPAR);
     break;
-    // Check FOLLOW set 
+    // Check FOLLOW set
   case SB_TIMES:
   case SB_SLASH:
   case SB_PLUS:
@@ -617,220 +843,189 @@ void compileArguments(ObjectNode* paramList) {
   }
 }
 
-void compileCondition(void) {
+AstIndex buildCondition(void) {
   Type* type1;
   Type* type2;
   TokenType op;
+  AstIndex node = createAstNode(AST_CONDITION);
 
-  type1 = compileExpression();
+  addAstChild(node, buildExpression(&type1));
   checkBasicType(type1);
 
   op = lookAhead->tokenType;
   switch (op) {
   case SB_EQ:
-    eat(SB_EQ);
-    break;
   case SB_NEQ:
-    eat(SB_NEQ);
-    break;
   case SB_LE:
-    eat(SB_LE);
-    break;
   case SB_LT:
-    eat(SB_LT);
-    break;
   case SB_GE:
-    eat(SB_GE);
-    break;
   case SB_GT:
-    eat(SB_GT);
+    eat(op);
     break;
   default:
     error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
   }
+  getAstNode(node)->op = op;
 
-  type2 = compileExpression();
+  addAstChild(node, buildExpression(&type2));
   checkTypeEquality(type1,type2);
-
-  switch (op) {
-  case SB_EQ:
-    genEQ();
-    break;
-  case SB_NEQ:
-    genNE();
-    break;
-  case SB_LE:
-    genLE();
-    break;
-  case SB_LT:
-    genLT();
-    break;
-  case SB_GE:
-    genGE();
-    break;
-  case SB_GT:
-    genGT();
-    break;
-  default:
-    break;
-  }
-
+  return node;
 }
 
-Type* compileExpression(void) {
-  Type* type;
-  
+AstIndex buildExpression(Type** type) {
+  AstIndex node;
+
   switch (lookAhead->tokenType) {
   case SB_PLUS:
     eat(SB_PLUS);
-    type = compileExpression2();
-    checkIntType(type);
+    node = buildExpression2(type);
+    checkIntType(*type);
     break;
   case SB_MINUS:
     eat(SB_MINUS);
-    type = compileExpression2();
-    checkIntType(type);
-    genNEG();
+    node = createAstNode(AST_NEGATE);
+    addAstChild(node, buildExpression2(type));
+    checkIntType(*type);
     break;
   default:
-    type = compileExpression2();
+    node = buildExpression2(type);
   }
-  return type;
+  return node;
 }
 
-Type* compileExpression2(void) {
-  Type* type;
+AstIndex buildExpression2(Type** type) {
+  AstIndex term = buildTerm(type);
 
-  type = compileTerm();
-  type = compileExpression3(type);
-
-  return type;
+  return buildExpression3(term, type);
 }
 
+// Append an operation to the chain starting with operand1, the chain
+// is created with the first operation
+AstIndex addOperation(AstIndex chain, AstIndex operand1, AstIndex operation) {
+  if (chain == operand1) {
+    chain = createAstNode(AST_EXPRESSION);
+    addAstChild(chain, operand1);
+  }
+  addAstChild(chain, operation);
+  return chain;
+}
 
-Type* compileExpression3(Type* argType1) {
+// *type is the type of operand1, which is the type of the chain
+AstIndex buildExpression3(AstIndex operand1, Type** type) {
   Type* argType2;
-  Type* resultType;
-
-  switch (lookAhead->tokenType) {
-  case SB_PLUS:
-    eat(SB_PLUS);
-    checkIntType(argType1);
-    argType2 = compileTerm();
-    checkIntType(argType2);
-
-    genAD();
-
-    resultType = compileExpression3(argType1);
-    break;
-  case SB_MINUS:
-    eat(SB_MINUS);
-    checkIntType(argType1);
-    argType2 = compileTerm();
-    checkIntType(argType2);
-
-    genSB();
+  AstIndex chain = operand1;
+  AstIndex operation;
+  TokenType op;
 
-    resultType = compileExpression3(argType1);
-    break;
-    // check the FOLLOW set
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    resultType = argType1;
-    break;
-  default:
-    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+  while (1) {
+    op = lookAhead->tokenType;
+    switch (op) {
+    case SB_PLUS:
+    case SB_MINUS:
+      eat(op);
+      checkIntType(*type);
+      operation = createAstNode(AST_OPERATION);
+      getAstNode(operation)->op = op;
+      addAstChild(operation, buildTerm(&argType2));
+      checkIntType(argType2);
+
+      chain = addOperation(chain, operand1, operation);
+      break;
+      // check the FOLLOW set
+    case KW_TO:
+    case KW_DO:
+    case SB_RPAR:
+    case SB_COMMA:
+    case SB_EQ:
+    case SB_NEQ:
+    case SB_LE:
+    case SB_LT:
+    case SB_GE:
+    case SB_GT:
+    case SB_RSEL:
+    case SB_SEMICOLON:
+    case KW_END:
+    case KW_ELSE:
+    case KW_THEN:
+      return chain;
+    default:
+      error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    }
   }
-  return resultType;
 }
 
-Type* compileTerm(void) {
-  Type* type;
-  type = compileFactor();
-  type = compileTerm2(type);
+AstIndex buildTerm(Type** type) {
+  AstIndex factor = buildFactor(type);
 
-  return type;
+  return buildTerm2(factor, type);
 }
 
-Type* compileTerm2(Type* argType1) {
+AstIndex buildTerm2(AstIndex operand1, Type** type) {
   Type* argType2;
-  Type* resultType;
-
-  switch (lookAhead->tokenType) {
-  case SB_TIMES:
-    eat(SB_TIMES);
-    checkIntType(argType1);
-    argType2 = compileFactor();
-    checkIntType(argType2);
-
-    genML();
-
-    resultType = compileTerm2(argType1);
-    break;
-  case SB_SLASH:
-    eat(SB_SLASH);
-    checkIntType(argType1);
-    argType2 = compileFactor();
-    checkIntType(argType2);
-
-    genDV();
+  AstIndex chain = operand1;
+  AstIndex operation;
+  TokenType op;
 
-    resultType = compileTerm2(argType1);
-    break;
-    // check the FOLLOW set
-  case SB_PLUS:
-  case SB_MINUS:
-  case KW_TO:
-  case KW_DO:
-  case SB_RPAR:
-  case SB_COMMA:
-  case SB_EQ:
-  case SB_NEQ:
-  case SB_LE:
-  case SB_LT:
-  case SB_GE:
-  case SB_GT:
-  case SB_RSEL:
-  case SB_SEMICOLON:
-  case KW_END:
-  case KW_ELSE:
-  case KW_THEN:
-    resultType = argType1;
-    break;
-  default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
+  while (1) {
+    op = lookAhead->tokenType;
+    switch (op) {
+    case SB_TIMES:
+    case SB_SLASH:
+      eat(op);
+      checkIntType(*type);
+      operation = createAstNode(AST_OPERATION);
+      getAstNode(operation)->op = op;
+      addAstChild(operation, buildFactor(&argType2));
+      checkIntType(argType2);
+
+      chain = addOperation(chain, operand1, operation);
+      break;
+      // check the FOLLOW set
+    case SB_PLUS:
+    case SB_MINUS:
+    case KW_TO:
+    case KW_DO:
+    case SB_RPAR:
+    case SB_COMMA:
+    case SB_EQ:
+    case SB_NEQ:
+    case SB_LE:
+    case SB_LT:
+    case SB_GE:
+    case SB_GT:
+    case SB_RSEL:
+    case SB_SEMICOLON:
+    case KW_END:
+    case KW_ELSE:
+    case KW_THEN:
+      return chain;
+    default:
+      error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
+    }
   }
-  return resultType;
 }
 
+AstIndex buildConstant(int value) {
+  AstIndex node = createAstNode(AST_CONSTANT);
 
-Type* compileFactor(void) {
-  Type* type;
+  getAstNode(node)->value = value;
+  return node;
+}
+
+AstIndex buildFactor(Type** type) {
   Object* obj;
+  AstIndex node = AST_NONE;
 
   switch (lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    type = intType;
-    genLC(currentToken->value);
+    *type = intType;
+    node = buildConstant(currentToken->value);
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    type = charType;
-    genLC(currentToken->value);
+    *type = charType;
+    node = buildConstant(currentToken->value);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
@@ -840,12 +1035,12 @@ Type* compileFactor(void) {
     case OBJ_CONSTANT:
       switch (obj->constAttrs->value->type) {
       case TP_INT:
-	type = intType;
-	genLC(obj->constAttrs->value->intValue);
+	*type = intType;
+	node = buildConstant(obj->constAttrs->value->intValue);
 	break;
       case TP_CHAR:
-	type = charType;
-	genLC(obj->constAttrs->value->charValue);
+	*type = charType;
+	node = buildConstant(obj->constAttrs->value->charValue);
 	break;
       default:
 	break;
@@ -853,61 +1048,52 @@ Type* compileFactor(void) {
       break;
     case OBJ_VARIABLE:
       if (obj->varAttrs->type->typeClass == TP_ARRAY) {
-	genVariableAddress(obj);
-	type = compileIndexes(obj->varAttrs->type);
-	genLI();
+	node = createObjectNode(AST_ELEMENT, obj);
+	*type = buildIndexes(node, obj->varAttrs->type);
       } else {
-	type = obj->varAttrs->type;
-	genVariableValue(obj);
+	*type = obj->varAttrs->type;
+	node = createObjectNode(AST_VARIABLE, obj);
       }
       break;
     case OBJ_PARAMETER:
-      type = obj->paramAttrs->type;
-      genParameterValue(obj);
-      if (obj->paramAttrs->kind == PARAM_REFERENCE)
-	genLI();
+      *type = obj->paramAttrs->type;
+      node = createObjectNode(AST_PARAMETER, obj);
       break;
     case OBJ_FUNCTION:
-      if (isPredefinedFunction(obj)) {
-	compileArguments(obj->funcAttrs->paramList);
-	genPredefinedFunctionCall(obj);
-      } else {
-	genINT(4);
-	compileArguments(obj->funcAttrs->paramList);
-	genDCT(4+obj->funcAttrs->paramCount);
-	genFunctionCall(obj);
-      }
-      type = obj->funcAttrs->returnType;
+      node = createObjectNode(AST_FUNCTION_CALL, obj);
+      buildArguments(obj->funcAttrs->paramList, node);
+      *type = obj->funcAttrs->returnType;
       break;
-    default: 
+    default:
       error(ERR_INVALID_FACTOR,currentToken->lineNo, currentToken->colNo);
       break;
     }
     break;
   case SB_LPAR:
     eat(SB_LPAR);
-    type = compileExpression();
+    node = buildExpression(type);
     eat(SB_RPAR);
     break;
   default:
     error(ERR_INVALID_FACTOR, lookAhead->lineNo, lookAhead->colNo);
   }
-  
-  return type;
+
+  return node;
 }
 
-Type* compileIndexes(Type* arrayType) {
-  // TEMPORARY: halt
+Type* buildIndexes(AstIndex element, Type* arrayType) {
   Type* type;
+  AstIndex index;
 
-  
   while (lookAhead->tokenType == SB_LSEL) {
     eat(SB_LSEL);
-    type = compileExpression();
+    index = createAstNode(AST_INDEX);
+    addAstChild(index, buildExpression(&type));
     checkIntType(type);
     checkArrayType(arrayType);
 
-    genHL();
+    getAstNode(index)->type = arrayType;
+    addAstChild(element, index);
 
     arrayType = arrayType->elementType;
     eat(SB_RSEL);
@@ -920,17 +1106,56 @@ int compile(char *fileName) {
   if (openInputStream(fileName) == IO_ERROR)
     return IO_ERROR;
 
+  enterPhase(PHASE_PARSER);
   currentToken = NULL;
   lookAhead = getValidToken();
 
   initSymTab();
+  initAst();
 
-  compileProgram();
+  sourceFileName = fileName;
+  if (lookAhead->tokenType == KW_UNIT)
+    compileUnitFile();
+  else compileProgram();
 
+  // Nothing is removed from the symbol table before the end
+  if (collectStats)
+    setSymbolCount(countSymbols());
   cleanSymTab();
+  cleanAst();
+  leavePhase();
   free(currentToken);
   free(lookAhead);
   closeInputStream();
   return IO_SUCCESS;
 
 }
+
+// kplc --outline: the declarations of the input and where they are, its 
+// bodies are skipped
+int compileOutline(char *fileName) {
+  int isUnit;
+
+  if (openInputStream(fileName) == IO_ERROR)
+    return IO_ERROR;
+
+  currentToken = NULL;
+  lookAhead = getValidToken();
+
+  initSymTab();
+
+  sourceFileName = fileName;
+  skipBodies = 1;
+  isUnit = (lookAhead->tokenType == KW_UNIT);
+  if (isUnit)
+    compileUnit();
+  else compileProgram();
+  skipBodies = 0;
+
+  printOutline(symtab->program, 0, isUnit);
+  cleanSymTab();
+  free(currentToken);
+  free(lookAhead);
+  closeInputStream();
+  return IO_SUCCESS;
+}
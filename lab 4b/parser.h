@@ -7,12 +7,22 @@
 #define __PARSER_H__
 #include "token.h"
 #include "symtab.h"
+#include "ast.h"
 
 void scan(void);
 void eat(TokenType tokenType);
+void locateObject(Object* obj);
 
 void compileProgram(void);
+Object* compileUnit(void);
+void compileUses(void);
+int useUnit(char* name);
+char* getUnitFileName(char* name, char* extension);
+Object* compileUnitSource(char* fileName, int lineNo, int colNo);
+void importUnit(char* name);
+void compileUnitFile(void);
 void compileBlock(void);
+void skipBlockBody(void);
 void compileBlock2(void);
 void compileBlock3(void);
 void compileBlock4(void);
@@ -24,6 +34,8 @@ void compileTypeDecl(void);
 void compileVarDecls(void);
 void compileVarDecl(void);
 void compileSubDecls(void);
+Object* compileFuncHeader(void);
+Object* compileProcHeader(void);
 void compileFuncDecl(void);
 void compileProcDecl(void);
 ConstantValue* compileUnsignedConstant(void);
@@ -33,27 +45,29 @@ Type* compileType(void);
 Type* compileBasicType(void);
 void compileParams(void);
 void compileParam(void);
-void compileStatements(void);
-void compileStatement(void);
-Type* compileLValue(void);
-void compileAssignSt(void);
-void compileCallSt(void);
-void compileGroupSt(void);
-void compileIfSt(void);
-void compileElseSt(void);
-void compileWhileSt(void);
-void compileForSt(void);
-void compileArgument(Object* param);
-void compileArguments(ObjectNode* paramList);
-void compileCondition(void);
-Type* compileExpression(void);
-Type* compileExpression2(void);
-Type* compileExpression3(Type* argType1);
-Type* compileTerm(void);
-Type* compileTerm2(Type* argType2);
-Type* compileFactor(void);
-Type* compileIndexes(Type* arrayType);
+void buildStatements(AstIndex group);
+AstIndex buildStatement(void);
+AstIndex buildLValue(Type** type);
+AstIndex buildAssignSt(void);
+AstIndex buildCallSt(void);
+AstIndex buildGroupSt(void);
+AstIndex buildIfSt(void);
+AstIndex buildWhileSt(void);
+AstIndex buildForSt(void);
+void buildArgument(Object* param, AstIndex call);
+void buildArguments(ObjectNode* paramList, AstIndex call);
+AstIndex buildCondition(void);
+AstIndex buildExpression(Type** type);
+AstIndex buildExpression2(Type** type);
+AstIndex buildExpression3(AstIndex operand1, Type** type);
+AstIndex addOperation(AstIndex chain, AstIndex operand1, AstIndex operation);
+AstIndex buildTerm(Type** type);
+AstIndex buildTerm2(AstIndex operand1, Type** type);
+AstIndex buildConstant(int value);
+AstIndex buildFactor(Type** type);
+Type* buildIndexes(AstIndex element, Type* arrayType);
 
 int compile(char *fileName);
+int compileOutline(char *fileName);
 
 #endif
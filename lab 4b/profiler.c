@@ -0,0 +1,286 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "profiler.h"
+
+int profiling = 0;
+
+CodeBlock* profiledCode;
+Counter opCodeCounts[OP_BP + 1];
+Counter* addressCounts;
+Counter totalCount;
+
+CallNode* callTree;
+CallNode* currentCall;
+CallStack returnCalls;
+
+// Counts of the subprograms, indexed by their code address
+Counter* selfCounts;
+Counter* totalCounts;
+
+void pushCallNode(CallStack* stack, CallNode* node) {
+  if (stack->count == stack->maxCount) {
+    stack->maxCount = (stack->maxCount == 0) ? 64 : 2 * stack->maxCount;
+    stack->nodes = (CallNode**) realloc(stack->nodes, stack->maxCount * sizeof(CallNode*));
+  }
+  stack->nodes[stack->count ++] = node;
+}
+
+CallNode* popCallNode(CallStack* stack) {
+  return stack->nodes[-- stack->count];
+}
+
+void freeCallStack(CallStack* stack) {
+  free(stack->nodes);
+  stack->nodes = NULL;
+  stack->count = stack->maxCount = 0;
+}
+
+CallNode* createCallNode(CodeAddress subprogram, CallNode* parent) {
+  CallNode* node = (CallNode*) malloc(sizeof(CallNode));
+
+  node->subprogram = subprogram;
+  node->count = 0;
+  node->sum = 0;
+  node->parent = parent;
+  node->child = NULL;
+  node->sibling = NULL;
+  return node;
+}
+
+// The subtrees are walked with a stack, not by recursion: the tree is as
+// deep as the subprograms are many
+void freeCallTree(CallNode* root) {
+  CallStack stack = {NULL, 0, 0};
+  CallNode* node;
+
+  pushCallNode(&stack, root);
+  while (stack.count > 0) {
+    node = popCallNode(&stack);
+    if (node->sibling != NULL) pushCallNode(&stack, node->sibling);
+    if (node->child != NULL) pushCallNode(&stack, node->child);
+    free(node);
+  }
+  freeCallStack(&stack);
+}
+
+// The nodes of the tree from the root, each before its callees and its
+// next siblings, as a recursive walk visits them
+void listCallTree(CallNode* root, CallStack* order) {
+  CallStack stack = {NULL, 0, 0};
+  CallNode* node;
+
+  pushCallNode(&stack, root);
+  while (stack.count > 0) {
+    node = popCallNode(&stack);
+    pushCallNode(order, node);
+    if (node->sibling != NULL) pushCallNode(&stack, node->sibling);
+    if (node->child != NULL) pushCallNode(&stack, node->child);
+  }
+  freeCallStack(&stack);
+}
+
+int initProfiler(CodeBlock* codeBlock) {
+  int i;
+
+  profiledCode = codeBlock;
+  addressCounts = (Counter*) calloc(codeBlock->codeSize, sizeof(Counter));
+  selfCounts = (Counter*) calloc(codeBlock->codeSize, sizeof(Counter));
+  totalCounts = (Counter*) calloc(codeBlock->codeSize, sizeof(Counter));
+  if ((addressCounts == NULL) || (selfCounts == NULL) || (totalCounts == NULL))
+    return 0;
+
+  for (i = 0; i <= OP_BP; i ++) 
+    opCodeCounts[i] = 0;
+  totalCount = 0;
+
+  callTree = createCallNode(0, NULL);
+  currentCall = callTree;
+  profiling = 1;
+  return 1;
+}
+
+void cleanProfiler(void) {
+  free(addressCounts);
+  free(selfCounts);
+  free(totalCounts);
+  freeCallStack(&returnCalls);
+  freeCallTree(callTree);
+  profiling = 0;
+}
+
+// A recursive call goes back to the node of the subprogram on the path,
+// so the tree and the folded stacks do not grow with the recursion
+void enterSubprogram(CodeAddress subprogram) {
+  CallNode* node;
+
+  pushCallNode(&returnCalls, currentCall);
+  for (node = currentCall; node->parent != NULL; node = node->parent)
+    if (node->subprogram == subprogram) {
+      currentCall = node;
+      return;
+    }
+
+  node = currentCall->child;
+  while ((node != NULL) && (node->subprogram != subprogram))
+    node = node->sibling;
+  if (node == NULL) {
+    node = createCallNode(subprogram, currentCall);
+    node->sibling = currentCall->child;
+    currentCall->child = node;
+  }
+  currentCall = node;
+}
+
+// Called before the instruction at address is executed
+void profileInstruction(CodeAddress address, Instruction* inst) {
+  opCodeCounts[inst->op] ++;
+  addressCounts[address] ++;
+  currentCall->count ++;
+  totalCount ++;
+
+  switch (inst->op) {
+  case OP_CALL:
+    enterSubprogram(inst->q);
+    break;
+  case OP_EP:
+  case OP_EF:
+    if (returnCalls.count > 0)
+      currentCall = popCallNode(&returnCalls);
+    break;
+  default:
+    break;
+  }
+}
+
+/******************************************************************/
+
+char* getSubprogramName(CodeAddress subprogram) {
+  static char name[32];
+
+  if (subprogram == 0) return "program";
+  sprintf(name, "sub@%d", subprogram);
+  return name;
+}
+
+// Sum the counts of the subtrees, the callees before their callers. A
+// subprogram is on a path once, its total counts each of its nodes once.
+void sumCallCounts(CallNode* root) {
+  CallStack order = {NULL, 0, 0};
+  CallNode* node;
+
+  listCallTree(root, &order);
+  while (order.count > 0) {
+    node = popCallNode(&order);
+    node->sum += node->count;
+    if (node->parent != NULL)
+      node->parent->sum += node->sum;
+    selfCounts[node->subprogram] += node->count;
+    totalCounts[node->subprogram] += node->sum;
+  }
+  freeCallStack(&order);
+}
+
+double percent(Counter count) {
+  return (totalCount == 0) ? 0.0 : (100.0 * count) / totalCount;
+}
+
+Counter* sortedCounts;
+
+int compareCounts(const void* a, const void* b) {
+  Counter countA = sortedCounts[*(int*) a];
+  Counter countB = sortedCounts[*(int*) b];
+
+  if (countA != countB) 
+    return (countA > countB) ? -1 : 1;
+  return *(int*) a - *(int*) b;
+}
+
+// Indexes of the non zero counts, sorted by decreasing counts, then -1
+int* sortByCount(Counter* counts, int n) {
+  int* order = (int*) malloc((n + 1) * sizeof(int));
+  int i, k = 0;
+
+  for (i = 0; i < n; i ++)
+    if (counts[i] > 0) order[k ++] = i;
+  order[k] = -1;
+
+  sortedCounts = counts;
+  qsort(order, k, sizeof(int), compareCounts);
+  return order;
+}
+
+void printProfile(FILE* f) {
+  Instruction inst;
+  int* order;
+  int i;
+
+  sumCallCounts(callTree);
+
+  fprintf(f, "Instructions executed: %lld\n", totalCount);
+
+  fprintf(f, "\nSubprograms           self     %%       total     %%\n");
+  order = sortByCount(selfCounts, profiledCode->codeSize);
+  for (i = 0; order[i] >= 0; i ++)
+    fprintf(f, "  %-12s %12lld %5.1f%% %12lld %5.1f%%\n", getSubprogramName(order[i]),
+	    selfCounts[order[i]], percent(selfCounts[order[i]]),
+	    totalCounts[order[i]], percent(totalCounts[order[i]]));
+  free(order);
+
+  fprintf(f, "\nInstructions         count     %%\n");
+  order = sortByCount(opCodeCounts, OP_BP + 1);
+  for (i = 0; order[i] >= 0; i ++)
+    fprintf(f, "  %-12s %12lld %5.1f%%\n", getOpCodeName(order[i]), 
+	    opCodeCounts[order[i]], percent(opCodeCounts[order[i]]));
+  free(order);
+
+  fprintf(f, "\nAddresses            count     %%\n");
+  order = sortByCount(addressCounts, profiledCode->codeSize);
+  for (i = 0; (i < HOT_ADDRESS_COUNT) && (order[i] >= 0); i ++) {
+    inst = profiledCode->code[order[i]];
+    fprintf(f, "  %-6d %-5s %12lld %5.1f%%\n", order[i], getOpCodeName(inst.op),
+	    addressCounts[order[i]], percent(addressCounts[order[i]]));
+  }
+  free(order);
+}
+
+void printCallPath(FILE* f, CallNode* node) {
+  CallStack path = {NULL, 0, 0};
+
+  for (; node != NULL; node = node->parent)
+    pushCallNode(&path, node);
+  fprintf(f, "%s", getSubprogramName(popCallNode(&path)->subprogram));
+  while (path.count > 0)
+    fprintf(f, ";%s", getSubprogramName(popCallNode(&path)->subprogram));
+  freeCallStack(&path);
+}
+
+// One line per call stack: the subprograms from the program on, separated
+// by ';', then the number of instructions executed in the last one. The
+// calls of a recursion are folded in its outermost one.
+void saveCallStacks(FILE* f, CallNode* root) {
+  CallStack order = {NULL, 0, 0};
+  int i;
+
+  listCallTree(root, &order);
+  for (i = 0; i < order.count; i ++)
+    if (order.nodes[i]->count > 0) {
+      printCallPath(f, order.nodes[i]);
+      fprintf(f, " %lld\n", order.nodes[i]->count);
+    }
+  freeCallStack(&order);
+}
+
+int saveFoldedStacks(char* fileName) {
+  FILE* f = fopen(fileName, "wt");
+
+  if (f == NULL) return 0;
+  saveCallStacks(f, callTree);
+  fclose(f);
+  return 1;
+}
@@ -0,0 +1,51 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdio.h>
+#include "instructions.h"
+
+// Number of addresses listed in the report
+#define HOT_ADDRESS_COUNT 20
+
+typedef long long Counter;
+
+// A node of the tree of the call stacks. A subprogram is on a path once:
+// a recursive call goes back to its outermost node.
+struct CallNode_ {
+  CodeAddress subprogram;      // code address of the subprogram, 0 for the program
+  Counter count;               // instructions executed in this call stack
+  Counter sum;                 // count of this node and of its callees
+  struct CallNode_* parent;
+  struct CallNode_* child;     // first callee
+  struct CallNode_* sibling;   // next callee of the parent
+};
+
+typedef struct CallNode_ CallNode;
+
+// The call nodes still to visit in a walk of the tree, or the nodes the
+// active calls return to
+struct CallStack_ {
+  CallNode** nodes;
+  int count;
+  int maxCount;
+};
+
+typedef struct CallStack_ CallStack;
+
+extern int profiling;
+
+int initProfiler(CodeBlock* codeBlock);
+void cleanProfiler(void);
+
+void profileInstruction(CodeAddress address, Instruction* inst);
+
+void printProfile(FILE* f);
+int saveFoldedStacks(char* fileName);
+
+#endif
@@ -35,3 +35,21 @@ void closeInputStream() {
   fclose(inputStream);
 }
 
+void saveInputStream(InputPosition* position) {
+  position->stream = inputStream;
+  position->lineNo = lineNo;
+  position->colNo = colNo;
+  position->currentChar = currentChar;
+}
+
+void restoreInputStream(InputPosition* position) {
+  inputStream = position->stream;
+  lineNo = position->lineNo;
+  colNo = position->colNo;
+  currentChar = position->currentChar;
+}
+
+// The byte of the current character in the file
+long getInputOffset(void) {
+  return ftell(inputStream) - ((currentChar == EOF) ? 0 : 1);
+}
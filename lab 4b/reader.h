@@ -10,8 +10,22 @@
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
+#include <stdio.h>
+
+// The stream put aside while another file is read
+struct InputPosition_ {
+  FILE* stream;
+  int lineNo, colNo;
+  int currentChar;
+};
+
+typedef struct InputPosition_ InputPosition;
+
 int readChar(void);
 int openInputStream(char *fileName);
 void closeInputStream(void);
+void saveInputStream(InputPosition* position);
+void restoreInputStream(InputPosition* position);
+long getInputOffset(void);
 
 #endif
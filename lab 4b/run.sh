@@ -4,6 +4,9 @@ set +e
 
 TEST_DIR="tests"
 TMP_DIR="tests/_tmp_output"
+# More options for kplc, e.g. KPLC_FLAGS=-ast to test the syntax tree
+KPLC_FLAGS=${KPLC_FLAGS:-}
+KPLRUN=${KPLRUN:-./kplrun}
 
 mkdir -p "$TMP_DIR"
 
@@ -42,7 +45,7 @@ for SRC in "$TEST_DIR"/*.kpl; do
   # -------------------------------
   # Run kplc.exe (CORRECT USAGE)
   # -------------------------------
-  ./kplc.exe "$SRC" "$OUT_BIN" -dump
+  ./kplc.exe "$SRC" "$OUT_BIN" -dump $KPLC_FLAGS
   if [ $? -ne 0 ]; then
     echo "❌ kplc.exe failed"
     FAIL=$((FAIL + 1))
@@ -84,6 +87,90 @@ for SRC in "$TEST_DIR"/*.kpl; do
   fi
 done
 
+# -------------------------------
+# The programs of tests/run are run at each optimization level, and
+# their output compared with name.out
+# -------------------------------
+for SRC in "$TEST_DIR"/run/*.kpl; do
+  NAME=$(basename "$SRC" .kpl)
+  EXP_OUT="$TEST_DIR/run/$NAME.out"
+  OUT_BIN="$TMP_DIR/$NAME"
+
+  for LEVEL in -O0 -O1 -O2; do
+    TOTAL=$((TOTAL + 1))
+
+    echo "----------------------------------------"
+    echo "Running $NAME.kpl $LEVEL"
+
+    rm -f "$OUT_BIN"
+    ./kplc.exe "$SRC" "$OUT_BIN" $LEVEL $KPLC_FLAGS
+    if [ $? -ne 0 ] || [ ! -f "$OUT_BIN" ]; then
+      echo "❌ kplc.exe failed"
+      FAIL=$((FAIL + 1))
+      continue
+    fi
+
+    if "$KPLRUN" "$OUT_BIN" < /dev/null > "$OUT_BIN.out" && cmp -s "$OUT_BIN.out" "$EXP_OUT"; then
+      echo "✅ PASS"
+      PASS=$((PASS + 1))
+    else
+      echo "❌ FAIL (Output differs)"
+      diff "$OUT_BIN.out" "$EXP_OUT" | head -5
+      FAIL=$((FAIL + 1))
+    fi
+  done
+done
+
+# -------------------------------
+# An expression of 100000 terms, generated by bench/generate.sh, is
+# compiled and run: its code is far larger than the initial code buffer
+# -------------------------------
+TOTAL=$((TOTAL + 1))
+echo "----------------------------------------"
+echo "Compiling an expression of 100000 terms"
+bash bench/generate.sh expression 100000 > "$TMP_DIR/expression.kpl"
+rm -f "$TMP_DIR/expression"
+if ./kplc.exe "$TMP_DIR/expression.kpl" "$TMP_DIR/expression" $KPLC_FLAGS > "$TMP_DIR/expression.log" &&
+   [ -f "$TMP_DIR/expression" ] && echo 7 | "$KPLRUN" "$TMP_DIR/expression" > "$TMP_DIR/expression.out"; then
+  echo "✅ PASS"
+  PASS=$((PASS + 1))
+else
+  echo "❌ FAIL"
+  head -5 "$TMP_DIR/expression.log"
+  FAIL=$((FAIL + 1))
+fi
+
+# -------------------------------
+# The programs of tests/profile are profiled, and their call stacks
+# compared with name.folded: a recursion is folded in one stack
+# -------------------------------
+for SRC in "$TEST_DIR"/profile/*.kpl; do
+  NAME=$(basename "$SRC" .kpl)
+  EXP_FOLDED="$TEST_DIR/profile/$NAME.folded"
+  OUT_BIN="$TMP_DIR/$NAME"
+  TOTAL=$((TOTAL + 1))
+
+  echo "----------------------------------------"
+  echo "Profiling $NAME.kpl"
+
+  rm -f "$OUT_BIN" "$OUT_BIN.folded"
+  ./kplc.exe "$SRC" "$OUT_BIN" $KPLC_FLAGS
+  if [ $? -ne 0 ] || [ ! -f "$OUT_BIN" ]; then
+    echo "❌ kplc.exe failed"
+    FAIL=$((FAIL + 1))
+    continue
+  fi
+
+  if "$KPLRUN" "$OUT_BIN" --profile < /dev/null > /dev/null 2>&1 && cmp -s "$OUT_BIN.folded" "$EXP_FOLDED"; then
+    echo "✅ PASS"
+    PASS=$((PASS + 1))
+  else
+    echo "❌ FAIL (Call stacks differ)"
+    head -c 1000 "$OUT_BIN.folded" | diff - "$EXP_FOLDED" | head -5
+    FAIL=$((FAIL + 1))
+  fi
+done
+
 echo "========================================"
 echo "Total : $TOTAL"
 echo "PASS  : $PASS"
@@ -7,12 +7,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 
 #include "reader.h"
 #include "charcode.h"
 #include "token.h"
 #include "error.h"
 #include "scanner.h"
+#include "stats.h"
 
 
 extern int lineNo;
@@ -236,15 +238,71 @@ Token* getToken(void) {
 }
 
 Token* getValidToken(void) {
-  Token *token = getToken();
+  Token *token;
+
+  enterPhase(PHASE_SCANNER);
+  token = getToken();
   while (token->tokenType == TK_NONE) {
     free(token);
     token = getToken();
   }
+  leavePhase();
   return token;
 }
 
 
+// Read the statements after BEGIN up to the matching END without making
+// tokens, counting the nested BEGIN and END. Returns the END, or the 
+// end of the file if it is missing.
+Token* skipBody(void) {
+  char word[5];
+  int depth = 1;
+  int count, ln, cn;
+
+  enterPhase(PHASE_SCANNER);
+  while (currentChar != EOF) {
+    switch (charCodes[currentChar]) {
+    case CHAR_LETTER:
+      ln = lineNo;
+      cn = colNo;
+      count = 0;
+      while ((currentChar != EOF) && 
+	     ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT))) {
+	if (count < 5) word[count] = toupper((char)currentChar);
+	count ++;
+	readChar();
+      }
+      if ((count == 5) && (strncmp(word, "BEGIN", 5) == 0))
+	depth ++;
+      else if ((count == 3) && (strncmp(word, "END", 3) == 0)) {
+	depth --;
+	if (depth == 0) {
+	  leavePhase();
+	  return makeToken(KW_END, ln, cn);
+	}
+      }
+      break;
+    case CHAR_SINGLEQUOTE:
+      // The character constant may be a quote or a letter
+      readChar();
+      if (currentChar != EOF) readChar();
+      if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SINGLEQUOTE)) readChar();
+      break;
+    case CHAR_LPAR:
+      readChar();
+      if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_TIMES)) {
+	readChar();
+	skipComment();
+      }
+      break;
+    default:
+      readChar();
+    }
+  }
+  leavePhase();
+  return makeToken(TK_EOF, lineNo, colNo);
+}
+
 /******************************************************************/
 
 void printToken(Token *token) {
@@ -259,6 +317,8 @@ void printToken(Token *token) {
   case TK_EOF: printf("TK_EOF\n"); break;
 
   case KW_PROGRAM: printf("KW_PROGRAM\n"); break;
+  case KW_UNIT: printf("KW_UNIT\n"); break;
+  case KW_USES: printf("KW_USES\n"); break;
   case KW_CONST: printf("KW_CONST\n"); break;
   case KW_TYPE: printf("KW_TYPE\n"); break;
   case KW_VAR: printf("KW_VAR\n"); break;
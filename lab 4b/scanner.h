@@ -11,6 +11,7 @@
 
 Token* getToken(void);
 Token* getValidToken(void);
+Token* skipBody(void);
 void printToken(Token *token);
 
 #endif
@@ -9,8 +9,9 @@
 #include "debug.h"
 #include "semantics.h"
 #include "error.h"
+#include "xref.h"
 
-extern SymTab* symtab;
+extern __thread SymTab* symtab;
 extern Token* currentToken;
 
 Object* lookupObject(char *name) {
@@ -37,6 +38,7 @@ Object* checkDeclaredIdent(char* name) {
   if (obj == NULL) {
     error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
   }
+  indexUse(obj);
   return obj;
 }
 
@@ -47,6 +49,7 @@ Object* checkDeclaredConstant(char* name) {
   if (obj->kind != OBJ_CONSTANT)
     error(ERR_INVALID_CONSTANT,currentToken->lineNo, currentToken->colNo);
 
+  indexUse(obj);
   return obj;
 }
 
@@ -57,6 +60,7 @@ Object* checkDeclaredType(char* name) {
   if (obj->kind != OBJ_TYPE)
     error(ERR_INVALID_TYPE,currentToken->lineNo, currentToken->colNo);
 
+  indexUse(obj);
   return obj;
 }
 
@@ -67,6 +71,7 @@ Object* checkDeclaredVariable(char* name) {
   if (obj->kind != OBJ_VARIABLE)
     error(ERR_INVALID_VARIABLE,currentToken->lineNo, currentToken->colNo);
 
+  indexUse(obj);
   return obj;
 }
 
@@ -77,6 +82,7 @@ Object* checkDeclaredFunction(char* name) {
   if (obj->kind != OBJ_FUNCTION)
     error(ERR_INVALID_FUNCTION,currentToken->lineNo, currentToken->colNo);
 
+  indexUse(obj);
   return obj;
 }
 
@@ -87,6 +93,7 @@ Object* checkDeclaredProcedure(char* name) {
   if (obj->kind != OBJ_PROCEDURE)
     error(ERR_INVALID_PROCEDURE,currentToken->lineNo, currentToken->colNo);
 
+  indexUse(obj);
   return obj;
 }
 
@@ -113,6 +120,7 @@ Object* checkDeclaredLValueIdent(char* name) {
     error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
   }
 
+  indexUse(obj);
   return obj;
 }
 
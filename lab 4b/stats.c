@@ -0,0 +1,116 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "stats.h"
+
+// Only the main thread collects statistics
+__thread int collectStats = 0;
+
+double phaseTimes[PHASE_COUNT];
+long phaseAllocations[PHASE_COUNT];
+long phaseBytes[PHASE_COUNT];
+
+enum Phase phases[MAX_PHASE_DEPTH];
+int phaseDepth;
+double phaseStart;
+
+int symbolCount;
+
+char* phaseNames[PHASE_COUNT] = {
+  "driver",
+  "scanner",
+  "parser",
+  "codegen",
+  "optimizer",
+  "serializer"
+};
+
+// Wall time in seconds
+double getTime(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void initStats(void) {
+  int i;
+
+  for (i = 0; i < PHASE_COUNT; i ++) {
+    phaseTimes[i] = 0;
+    phaseAllocations[i] = 0;
+    phaseBytes[i] = 0;
+  }
+  phases[0] = PHASE_DRIVER;
+  phaseDepth = 1;
+  phaseStart = getTime();
+  symbolCount = 0;
+  collectStats = 1;
+}
+
+enum Phase getCurrentPhase(void) {
+  if (phaseDepth > MAX_PHASE_DEPTH) 
+    return phases[MAX_PHASE_DEPTH - 1];
+  return phases[phaseDepth - 1];
+}
+
+// Charge the time elapsed since the last change to the current phase
+void switchPhase(void) {
+  double now = getTime();
+
+  phaseTimes[getCurrentPhase()] += now - phaseStart;
+  phaseStart = now;
+}
+
+void enterPhase(enum Phase phase) {
+  if (!collectStats) return;
+  switchPhase();
+  if (phaseDepth < MAX_PHASE_DEPTH) 
+    phases[phaseDepth] = phase;
+  phaseDepth ++;
+}
+
+void leavePhase(void) {
+  if (!collectStats) return;
+  switchPhase();
+  phaseDepth --;
+}
+
+void countAllocation(size_t size) {
+  enum Phase phase;
+
+  if (!collectStats) return;
+  phase = getCurrentPhase();
+  phaseAllocations[phase] ++;
+  phaseBytes[phase] += size;
+}
+
+void setSymbolCount(int count) {
+  if (count > symbolCount) 
+    symbolCount = count;
+}
+
+void printStats(int codeSize) {
+  double totalTime = 0;
+  long totalAllocations = 0;
+  long totalBytes = 0;
+  int i;
+
+  switchPhase();
+  printf("Phase          time (ms)  allocations        bytes\n");
+  for (i = 0; i < PHASE_COUNT; i ++) {
+    printf("  %-10s %12.3f %12ld %12ld\n", phaseNames[i], 
+	   phaseTimes[i] * 1000, phaseAllocations[i], phaseBytes[i]);
+    totalTime += phaseTimes[i];
+    totalAllocations += phaseAllocations[i];
+    totalBytes += phaseBytes[i];
+  }
+  printf("  %-10s %12.3f %12ld %12ld\n", "total", totalTime * 1000, totalAllocations, totalBytes);
+  printf("Symbol table: %d objects\n", symbolCount);
+  printf("Code size: %d instructions\n", codeSize);
+}
@@ -0,0 +1,38 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stddef.h>
+
+// Phases of the compiler. Time spent in a phase called from another one
+// is not counted in the caller.
+enum Phase {
+  PHASE_DRIVER,
+  PHASE_SCANNER,
+  PHASE_PARSER,
+  PHASE_CODEGEN,
+  PHASE_OPTIMIZER,
+  PHASE_SERIALIZER,
+  PHASE_COUNT
+};
+
+// Maximum nesting of the phases
+#define MAX_PHASE_DEPTH 16
+
+extern __thread int collectStats;
+
+void initStats(void);
+void enterPhase(enum Phase phase);
+void leavePhase(void);
+
+void countAllocation(size_t size);
+void setSymbolCount(int count);
+
+void printStats(int codeSize);
+
+#endif
@@ -16,7 +16,8 @@ void freeScope(Scope* scope);
 void freeObjectList(ObjectNode *objList);
 void freeReferenceList(ObjectNode *objList);
 
-SymTab* symtab;
+// Threads generating code each have their own current scope
+__thread SymTab* symtab;
 Type* intType;
 Type* charType;
 Object* writeiProcedure;
@@ -67,7 +68,9 @@ int compareType(Type* type1, Type* type2) {
   } else return 0;
 }
 
+// The objects of a declaration left by an error may have no type yet
 void freeType(Type* type) {
+  if (type == NULL) return;
   switch (type->typeClass) {
   case TP_INT:
   case TP_CHAR:
@@ -75,7 +78,7 @@ void freeType(Type* type) {
     break;
   case TP_ARRAY:
     freeType(type->elementType);
-    freeType(type);
+    free(type);
     break;
   }
 }
@@ -126,13 +129,22 @@ Scope* createScope(Object* owner) {
   scope->owner = owner;
   scope->outer = NULL;
   scope->frameSize = RESERVED_WORDS;
+  scope->bodyStart = scope->bodyEnd = 0;
   return scope;
 }
 
+// The parser gives the position of the objects it declares
+Object* createObject(char *name, enum ObjectKind kind) {
+  Object* obj = (Object*) malloc(sizeof(Object));
+  strcpy(obj->name, name);
+  obj->kind = kind;
+  obj->lineNo = 0;
+  obj->colNo = 0;
+  return obj;
+}
+
 Object* createProgramObject(char *programName) {
-  Object* program = (Object*) malloc(sizeof(Object));
-  strcpy(program->name, programName);
-  program->kind = OBJ_PROGRAM;
+  Object* program = createObject(programName, OBJ_PROGRAM);
   program->progAttrs = (ProgramAttributes*) malloc(sizeof(ProgramAttributes));
   program->progAttrs->scope = createScope(program);
   program->progAttrs->codeAddress = DC_VALUE;
@@ -142,25 +154,21 @@ Object* createProgramObject(char *programName) {
 }
 
 Object* createConstantObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_CONSTANT;
+  Object* obj = createObject(name, OBJ_CONSTANT);
   obj->constAttrs = (ConstantAttributes*) malloc(sizeof(ConstantAttributes));
+  obj->constAttrs->value = NULL;
   return obj;
 }
 
 Object* createTypeObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_TYPE;
+  Object* obj = createObject(name, OBJ_TYPE);
   obj->typeAttrs = (TypeAttributes*) malloc(sizeof(TypeAttributes));
+  obj->typeAttrs->actualType = NULL;
   return obj;
 }
 
 Object* createVariableObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_VARIABLE;
+  Object* obj = createObject(name, OBJ_VARIABLE);
   obj->varAttrs = (VariableAttributes*) malloc(sizeof(VariableAttributes));
   obj->varAttrs->type = NULL;
   obj->varAttrs->scope = NULL;
@@ -169,9 +177,7 @@ Object* createVariableObject(char *name) {
 }
 
 Object* createFunctionObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_FUNCTION;
+  Object* obj = createObject(name, OBJ_FUNCTION);
   obj->funcAttrs = (FunctionAttributes*) malloc(sizeof(FunctionAttributes));
   obj->funcAttrs->returnType = NULL;
   obj->funcAttrs->paramList = NULL;
@@ -182,9 +188,7 @@ Object* createFunctionObject(char *name) {
 }
 
 Object* createProcedureObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PROCEDURE;
+  Object* obj = createObject(name, OBJ_PROCEDURE);
   obj->procAttrs = (ProcedureAttributes*) malloc(sizeof(ProcedureAttributes));
   obj->procAttrs->paramList = NULL;
   obj->procAttrs->paramCount = 0;
@@ -194,9 +198,7 @@ Object* createProcedureObject(char *name) {
 }
 
 Object* createParameterObject(char *name, enum ParamKind kind) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PARAMETER;
+  Object* obj = createObject(name, OBJ_PARAMETER);
   obj->paramAttrs = (ParameterAttributes*) malloc(sizeof(ParameterAttributes));
   obj->paramAttrs->kind = kind;
   obj->paramAttrs->type = NULL;
@@ -290,6 +292,28 @@ Object* findObject(ObjectNode *objList, char *name) {
   return NULL;
 }
 
+// Objects of a list, with the objects of the subprograms declared in it
+int countObjects(ObjectNode* objList) {
+  int count = 0;
+
+  for (; objList != NULL; objList = objList->next) {
+    count ++;
+    if (objList->object->kind == OBJ_FUNCTION)
+      count += countObjects(objList->object->funcAttrs->scope->objList);
+    else if (objList->object->kind == OBJ_PROCEDURE)
+      count += countObjects(objList->object->procAttrs->scope->objList);
+  }
+  return count;
+}
+
+int countSymbols(void) {
+  int count = countObjects(symtab->globalObjectList);
+
+  if (symtab->program != NULL)
+    count += 1 + countObjects(symtab->program->progAttrs->scope->objList);
+  return count;
+}
+
 /******************* others ******************************/
 
 void initSymTab(void) {
@@ -333,7 +357,8 @@ void initSymTab(void) {
 }
 
 void cleanSymTab(void) {
-  freeObject(symtab->program);
+  if (symtab->program != NULL)
+    freeObject(symtab->program);
   freeObjectList(symtab->globalObjectList);
   free(symtab);
   freeType(intType);
@@ -348,6 +373,29 @@ void exitBlock(void) {
   symtab->currentScope = symtab->currentScope->outer;
 }
 
+// The objects declared by a unit become global, as the predefined ones.
+// The unit itself is freed.
+void importObjects(Object* unit) {
+  ObjectNode* node;
+
+  for (node = unit->progAttrs->scope->objList; node != NULL; node = node->next)
+    if (node->object->kind == OBJ_FUNCTION)
+      node->object->funcAttrs->scope->outer = NULL;
+    else if (node->object->kind == OBJ_PROCEDURE)
+      node->object->procAttrs->scope->outer = NULL;
+
+  if (symtab->globalObjectList == NULL)
+    symtab->globalObjectList = unit->progAttrs->scope->objList;
+  else {
+    node = symtab->globalObjectList;
+    while (node->next != NULL)
+      node = node->next;
+    node->next = unit->progAttrs->scope->objList;
+  }
+  unit->progAttrs->scope->objList = NULL;
+  freeObject(unit);
+}
+
 void declareObject(Object* obj) {
   Object* owner;
 
@@ -111,6 +111,7 @@ typedef struct ParameterAttributes_ ParameterAttributes;
 struct Object_ {
   char name[MAX_IDENT_LEN];
   enum ObjectKind kind;
+  int lineNo, colNo;      // where it is declared, 0 for the predefined and imported objects
   union {
     ConstantAttributes* constAttrs;
     VariableAttributes* varAttrs;
@@ -136,6 +137,7 @@ struct Scope_ {
   Object *owner;
   struct Scope_ *outer;
   int frameSize;
+  long bodyStart, bodyEnd;   // the bytes from BEGIN to after END, when the body is skipped
 };
 
 typedef struct Scope_ Scope;
@@ -162,6 +164,7 @@ ConstantValue* duplicateConstantValue(ConstantValue* v);
 
 Scope* createScope(Object* owner);
 
+Object* createObject(char *name, enum ObjectKind kind);
 Object* createProgramObject(char *programName);
 Object* createConstantObject(char *name);
 Object* createTypeObject(char *name);
@@ -170,12 +173,16 @@ Object* createFunctionObject(char *name);
 Object* createProcedureObject(char *name);
 Object* createParameterObject(char *name, enum ParamKind kind);
 
+void freeObject(Object* obj);
 Object* findObject(ObjectNode *objList, char *name);
+int countObjects(ObjectNode* objList);
+int countSymbols(void);
 
 void initSymTab(void);
 void cleanSymTab(void);
 void enterBlock(Scope* scope);
 void exitBlock(void);
 void declareObject(Object* obj);
+void importObjects(Object* unit);
 
 #endif
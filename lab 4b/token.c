@@ -13,6 +13,8 @@ struct {
   TokenType tokenType;
 } keywords[KEYWORDS_COUNT] = {
   {"PROGRAM", KW_PROGRAM},
+  {"UNIT", KW_UNIT},
+  {"USES", KW_USES},
   {"CONST", KW_CONST},
   {"TYPE", KW_TYPE},
   {"VAR", KW_VAR},
@@ -67,6 +69,8 @@ char *tokenToString(TokenType tokenType) {
   case TK_EOF: return "end of file";
 
   case KW_PROGRAM: return "keyword PROGRAM";
+  case KW_UNIT: return "keyword UNIT";
+  case KW_USES: return "keyword USES";
   case KW_CONST: return "keyword CONST";
   case KW_TYPE: return "keyword TYPE";
   case KW_VAR: return "keyword VAR";
@@ -0,0 +1,299 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "codegen.h"
+#include "verifier.h"
+
+#define NO_OWNER -1
+#define NO_LEVEL -1
+// Depth of the empty stack of a frame: t = b - 1
+#define EMPTY_DEPTH -1
+
+int* frameSizes = NULL;
+
+CodeBlock* verifiedCode;
+int maxStackSize;
+CodeAddress errorAddress;
+
+// Indexed by code address
+int* depths;          // t - b before the instruction
+CodeAddress* owners;  // entry of the subprogram the instruction belongs to
+int* levels;          // static level of the subprogram at an entry
+CodeAddress* parents; // entry of the enclosing subprogram
+int* maxDepths;       // highest t - b in the subprogram at an entry
+
+CodeAddress* pending; // instructions to visit in the current subprogram
+int pendingCount;
+CodeAddress* entries; // subprograms to verify
+int entryCount;
+
+// Words of the stack an instruction reads below t
+int getOperandCount(enum OpCode op) {
+  switch (op) {
+  case OP_LI:
+  case OP_FJ:
+  case OP_WRC:
+  case OP_WRI:
+  case OP_NEG:
+  case OP_CV:
+  case OP_BC:
+    return 1;
+  case OP_ST:
+  case OP_AD:
+  case OP_SB:
+  case OP_ML:
+  case OP_DV:
+  case OP_EQ:
+  case OP_NE:
+  case OP_GT:
+  case OP_LT:
+  case OP_GE:
+  case OP_LE:
+  case OP_FS:
+  case OP_JEQ:
+  case OP_JNE:
+  case OP_JGT:
+  case OP_JLT:
+  case OP_JGE:
+  case OP_JLE:
+    return 2;
+  case OP_FI:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+int isValidAddress(CodeAddress address) {
+  return (address >= 0) && (address < verifiedCode->codeSize);
+}
+
+// The subprogram p levels above the one at entry
+CodeAddress getAncestor(CodeAddress entry, int p) {
+  while (p > 0) {
+    entry = parents[entry];
+    p --;
+  }
+  return entry;
+}
+
+int visit(CodeAddress address, CodeAddress entry, int depth) {
+  if (!isValidAddress(address)) 
+    return VS_ILLEGAL_ADDRESS;
+
+  if (owners[address] == NO_OWNER) {
+    owners[address] = entry;
+    depths[address] = depth;
+    pending[pendingCount ++] = address;
+  } else if (owners[address] != entry)
+    return VS_SHARED_CODE;
+  else if (depths[address] != depth)
+    return VS_INCONSISTENT_STACK;
+  return VS_VALID;
+}
+
+// A subprogram called at level p from the one at entry
+int addEntry(CodeAddress address, CodeAddress entry, int p) {
+  CodeAddress parent;
+  int level;
+
+  if (!isValidAddress(address)) 
+    return VS_ILLEGAL_ADDRESS;
+  if ((p < 0) || (p > levels[entry]))
+    return VS_ILLEGAL_LEVEL;
+
+  level = levels[entry] - p + 1;
+  parent = getAncestor(entry, p);
+  if (levels[address] == NO_LEVEL) {
+    if (owners[address] != NO_OWNER) 
+      return VS_SHARED_CODE;
+    levels[address] = level;
+    parents[address] = parent;
+    entries[entryCount ++] = address;
+  } else if ((levels[address] != level) || (parents[address] != parent))
+    return VS_ILLEGAL_LEVEL;
+  return VS_VALID;
+}
+
+// Follow every path of the subprogram at entry
+int verifySubprogram(CodeAddress entry) {
+  CodeAddress address;
+  Instruction* inst;
+  int depth;
+  int state;
+
+  pendingCount = 0;
+  maxDepths[entry] = EMPTY_DEPTH;
+  state = visit(entry, entry, EMPTY_DEPTH);
+
+  while ((state == VS_VALID) && (pendingCount > 0)) {
+    address = pending[-- pendingCount];
+    errorAddress = address;
+    inst = verifiedCode->code + address;
+
+    if ((inst->op < OP_LA) || (inst->op > OP_BP))
+      return VS_ILLEGAL_INSTRUCTION;
+    if (depths[address] - getOperandCount(inst->op) < EMPTY_DEPTH)
+      return VS_STACK_UNDERFLOW;
+
+    depth = depths[address] + getStackEffect(inst);
+    if (depth < EMPTY_DEPTH)
+      return VS_STACK_UNDERFLOW;
+    if (depth >= maxStackSize)
+      return VS_STACK_OVERFLOW;
+    if (depth > maxDepths[entry])
+      maxDepths[entry] = depth;
+
+    switch (inst->op) {
+    case OP_LA:
+    case OP_LV:
+      if ((inst->p < 0) || (inst->p > levels[entry]))
+	return VS_ILLEGAL_LEVEL;
+      break;
+    case OP_CALL:
+      state = addEntry(inst->q, entry, inst->p);
+      break;
+    case OP_EP:
+    case OP_EF:
+      // The program has no caller to return to
+      if (levels[entry] == 0)
+	return VS_ILLEGAL_INSTRUCTION;
+      break;
+    default:
+      if (isBranchInstruction(inst->op))
+	state = visit(inst->q, entry, depth);
+      break;
+    }
+
+    if (state != VS_VALID)
+      return state;
+
+    switch (inst->op) {
+    case OP_J:
+    case OP_HL:
+    case OP_EP:
+    case OP_EF:
+      break;
+    default:
+      state = visit(address + 1, entry, depth);
+      break;
+    }
+  }
+  return state;
+}
+
+// LV reads a variable of a frame on the stack, below the highest t of 
+// that frame. The frames are known once every subprogram is verified.
+int verifyVariables(void) {
+  CodeAddress address;
+  Instruction* inst;
+  CodeAddress frame;
+
+  for (address = 0; address < verifiedCode->codeSize; address ++) {
+    inst = verifiedCode->code + address;
+    if ((owners[address] == NO_OWNER) || (inst->op != OP_LV))
+      continue;
+
+    errorAddress = address;
+    frame = getAncestor(owners[address], inst->p);
+    if ((inst->q < 0) || (inst->q > maxDepths[frame]))
+      return VS_ILLEGAL_ADDRESS;
+  }
+  return VS_VALID;
+}
+
+void freeTables(void) {
+  free(depths);
+  free(owners);
+  free(levels);
+  free(parents);
+  free(maxDepths);
+  free(pending);
+  free(entries);
+}
+
+int verifyCode(CodeBlock* codeBlock, int stackSize) {
+  int size = codeBlock->codeSize;
+  int state = VS_VALID;
+  int i;
+
+  verifiedCode = codeBlock;
+  maxStackSize = stackSize;
+  errorAddress = 0;
+
+  depths = (int*) malloc(size * sizeof(int));
+  owners = (CodeAddress*) malloc(size * sizeof(CodeAddress));
+  levels = (int*) malloc(size * sizeof(int));
+  parents = (CodeAddress*) malloc(size * sizeof(CodeAddress));
+  maxDepths = (int*) malloc(size * sizeof(int));
+  pending = (CodeAddress*) malloc(size * sizeof(CodeAddress));
+  entries = (CodeAddress*) malloc(size * sizeof(CodeAddress));
+  frameSizes = (int*) malloc(size * sizeof(int));
+  if ((depths == NULL) || (owners == NULL) || (levels == NULL) || 
+      (parents == NULL) || (maxDepths == NULL) || (pending == NULL) || 
+      (entries == NULL) || (frameSizes == NULL)) {
+    freeTables();
+    return VS_OUT_OF_MEMORY;
+  }
+
+  if (size == 0) 
+    state = VS_ILLEGAL_ADDRESS;
+
+  for (i = 0; i < size; i ++) {
+    owners[i] = NO_OWNER;
+    levels[i] = NO_LEVEL;
+    frameSizes[i] = 0;
+  }
+
+  // The program is at level 0, and starts at address 0
+  if (state == VS_VALID) {
+    levels[0] = 0;
+    parents[0] = 0;
+    entries[0] = 0;
+    entryCount = 1;
+  } else entryCount = 0;
+
+  for (i = 0; (state == VS_VALID) && (i < entryCount); i ++)
+    state = verifySubprogram(entries[i]);
+
+  if (state == VS_VALID)
+    state = verifyVariables();
+
+  // CALL writes the links up to b + STATIC_LINK_OFFSET
+  for (i = 0; (state == VS_VALID) && (i < entryCount); i ++) {
+    if (maxDepths[entries[i]] < STATIC_LINK_OFFSET)
+      maxDepths[entries[i]] = STATIC_LINK_OFFSET;
+    frameSizes[entries[i]] = maxDepths[entries[i]] + 1;
+  }
+
+  freeTables();
+  return state;
+}
+
+void cleanVerifier(void) {
+  free(frameSizes);
+  frameSizes = NULL;
+}
+
+// Address of the first instruction found invalid
+CodeAddress getVerifierErrorAddress(void) {
+  return errorAddress;
+}
+
+char* verifierErrorMessage(int state) {
+  switch (state) {
+  case VS_ILLEGAL_INSTRUCTION: return "Illegal instruction.";
+  case VS_ILLEGAL_ADDRESS: return "Illegal address.";
+  case VS_ILLEGAL_LEVEL: return "Illegal level.";
+  case VS_STACK_UNDERFLOW: return "Stack underflow.";
+  case VS_STACK_OVERFLOW: return "Stack overflow.";
+  case VS_INCONSISTENT_STACK: return "Inconsistent stack depth.";
+  case VS_SHARED_CODE: return "Code shared by two subprograms.";
+  case VS_OUT_OF_MEMORY: return "Out of memory.";
+  default: return "Unknown error.";
+  }
+}
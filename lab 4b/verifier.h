@@ -0,0 +1,33 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VERIFIER_H__
+#define __VERIFIER_H__
+
+#include "instructions.h"
+
+enum VerifierState {
+  VS_VALID,
+  VS_ILLEGAL_INSTRUCTION,
+  VS_ILLEGAL_ADDRESS,
+  VS_ILLEGAL_LEVEL,
+  VS_STACK_UNDERFLOW,
+  VS_STACK_OVERFLOW,
+  VS_INCONSISTENT_STACK,
+  VS_SHARED_CODE,
+  VS_OUT_OF_MEMORY
+};
+
+// Words used above t by a call of the subprogram at each entry address
+extern int* frameSizes;
+
+int verifyCode(CodeBlock* codeBlock, int stackSize);
+void cleanVerifier(void);
+
+CodeAddress getVerifierErrorAddress(void);
+char* verifierErrorMessage(int state);
+
+#endif
@@ -0,0 +1,413 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "reader.h"
+#include "codegen.h"
+#include "vm.h"
+#include "profiler.h"
+#include "verifier.h"
+#include "vmio.h"
+
+CodeBlock* codeBlock;
+
+char* stackMemory = NULL;
+size_t stackMemorySize;
+WORD* stack;
+int stackSize;
+
+// The stack is followed by a guard area, at least as large as any frame:
+// a frame running past the end of the stack faults in the guard area.
+char* guardArea;
+size_t guardSize;
+sigjmp_buf overflowJump;
+
+int ps;  // program state
+CodeAddress programCounter;  // when run returns
+
+int loadExecutable(char* fileName) {
+  FILE* f;
+  long size;
+
+  f = fopen(fileName, "rb");
+  if (f == NULL) return IO_ERROR;
+
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  codeBlock = createCodeBlock(size / sizeof(Instruction) + 1);
+  loadCode(codeBlock, f);
+  fclose(f);
+  return IO_SUCCESS;
+}
+
+size_t roundToPages(size_t size) {
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+
+  return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+void handleSegmentationFault(int signalNumber, siginfo_t* info, void* context) {
+  struct sigaction action;
+  char* address = (char*) info->si_addr;
+
+  if ((address >= guardArea) && (address < guardArea + guardSize))
+    siglongjmp(overflowJump, 1);
+
+  // Not an overflow: crash as usual when the instruction runs again
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIG_DFL;
+  sigaction(signalNumber, &action, NULL);
+}
+
+// The verified frame sizes give the size of the guard area
+int initVM(int size) {
+  struct sigaction action;
+  size_t stackBytes;
+  int frameSize = 0;
+  int i;
+
+  for (i = 0; i < codeBlock->codeSize; i ++)
+    if (frameSizes[i] > frameSize)
+      frameSize = frameSizes[i];
+
+  // stack[-1] receives the top of the empty stack
+  stackBytes = roundToPages((size + 1) * sizeof(WORD));
+  guardSize = roundToPages(frameSize * sizeof(WORD));
+  stackMemorySize = stackBytes + guardSize;
+  stackMemory = (char*) mmap(NULL, stackMemorySize, PROT_READ | PROT_WRITE, 
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (stackMemory == MAP_FAILED) {
+    stackMemory = NULL;
+    return 0;
+  }
+
+  guardArea = stackMemory + stackBytes;
+  if (mprotect(guardArea, guardSize, PROT_NONE) != 0)
+    return 0;
+  stack = ((WORD*) guardArea) - size;
+  stackSize = size;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = handleSegmentationFault;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  return sigaction(SIGSEGV, &action, NULL) == 0;
+}
+
+void cleanVM(void) {
+  if (stackMemory != NULL)
+    munmap(stackMemory, stackMemorySize);
+  freeCodeBlock(codeBlock);
+}
+
+// Follow the static links p levels up from the base b. Links are never
+// the cached top: they are written by CALL above the top, and never changed.
+int base(int b, int p) {
+  int currentBase = b;
+
+  while (p > 0) {
+    currentBase = stack[currentBase + STATIC_LINK_OFFSET];
+    p --;
+  }
+  return currentBase;
+}
+
+int checkAddress(WORD address) {
+  if ((address < 0) || (address >= stackSize)) {
+    ps = PS_ILLEGAL_ADDRESS;
+    return 0;
+  }
+  return 1;
+}
+
+// A return address is read from the stack, where the program may have 
+// overwritten it
+int checkCodeAddress(WORD address) {
+  if ((address < 0) || (address >= codeBlock->codeSize)) {
+    ps = PS_ILLEGAL_ADDRESS;
+    return 0;
+  }
+  return 1;
+}
+
+// s[t] is kept in top, and stack[t] is out of date. It is written back 
+// when t moves up, and reloaded when t moves down.
+#define PUSH(value) { stack[t] = top; t ++; top = (value); }
+#define POP() { t --; top = stack[t]; }
+#define LOAD(address) (((address) == t) ? top : stack[address])
+#define STORE(address, value) { if ((address) == t) top = (value); else stack[address] = (value); }
+
+// The registers of the machine are local, for the C compiler to keep 
+// them in registers of the processor.
+// The code is verified when loaded: the jumps, the levels and the depth of
+// the stack in each frame are valid, and an overflow faults in the guard
+// area. Only the addresses computed at run time are checked.
+int run(void) {
+  register int t = -1;   // top of the stack
+  register int b = 0;    // base of the current frame
+  register int pc = 0;   // program counter
+  register WORD top = 0;
+  Instruction* inst;
+  WORD address, value;
+  int newBase;
+  int n;
+
+  if (sigsetjmp(overflowJump, 1) != 0) {
+    // The registers are lost, the overflow is reported at the last call
+    flushOutput();
+    ps = PS_STACK_OVERFLOW;
+    return ps;
+  }
+
+  ps = (frameSizes[0] > stackSize) ? PS_STACK_OVERFLOW : PS_ACTIVE;
+
+  while (ps == PS_ACTIVE) {
+    inst = codeBlock->code + pc;
+    if (profiling) 
+      profileInstruction(pc, inst);
+    pc ++;
+
+    switch (inst->op) {
+    case OP_LA:
+      PUSH(base(b, inst->p) + inst->q);
+      break;
+    case OP_LV:
+      address = base(b, inst->p) + inst->q;
+      PUSH(LOAD(address));
+      break;
+    case OP_LC:
+      PUSH(inst->q);
+      break;
+    case OP_LI:
+      if (checkAddress(top))
+	top = LOAD(top);
+      break;
+    case OP_INT:
+      stack[t] = top;
+      t += inst->q;
+      top = stack[t];
+      break;
+    case OP_DCT:
+      // The words above t are still used by CALL
+      stack[t] = top;
+      t -= inst->q;
+      top = stack[t];
+      break;
+    case OP_J:
+      pc = inst->q;
+      break;
+    case OP_FJ:
+      if (top == FALSE)
+	pc = inst->q;
+      POP();
+      break;
+    case OP_HL:
+      ps = PS_SUCCESS;
+      break;
+    case OP_ST:
+      address = stack[t-1];
+      if (checkAddress(address)) {
+	value = top;
+	t -= 2;
+	top = stack[t];
+	STORE(address, value);
+      }
+      break;
+    case OP_CALL:
+      newBase = t + 1;
+      programCounter = pc;
+      stack[newBase + DYNAMIC_LINK_OFFSET] = b;
+      stack[newBase + RETURN_ADDRESS_OFFSET] = pc;
+      stack[newBase + STATIC_LINK_OFFSET] = base(b, inst->p);
+      b = newBase;
+      pc = inst->q;
+      break;
+    case OP_EP:
+      // The procedure frame started on the caller's top of the stack
+      if (checkCodeAddress(stack[b + RETURN_ADDRESS_OFFSET])) {
+	t = b;
+	top = stack[t];
+	pc = stack[b + RETURN_ADDRESS_OFFSET];
+	b = stack[b + DYNAMIC_LINK_OFFSET];
+      }
+      break;
+    case OP_EF:
+      if (checkCodeAddress(stack[b + RETURN_ADDRESS_OFFSET])) {
+	t = b;
+	top = stack[t];
+	pc = stack[b + RETURN_ADDRESS_OFFSET];
+	b = stack[b + DYNAMIC_LINK_OFFSET];
+      }
+      break;
+    case OP_RC:
+      PUSH(inputChar());
+      break;
+    case OP_RI:
+      if (!inputInt(&n)) 
+	ps = PS_IO_ERROR;
+      else PUSH(n);
+      break;
+    case OP_WRC:
+      outputChar(top);
+      POP();
+      break;
+    case OP_WRI:
+      outputInt(top);
+      POP();
+      break;
+    case OP_WLN:
+      outputChar('\n');
+      break;
+    case OP_AD:
+      t --;
+      top = stack[t] + top;
+      break;
+    case OP_SB:
+      t --;
+      top = stack[t] - top;
+      break;
+    case OP_ML:
+      t --;
+      top = stack[t] * top;
+      break;
+    case OP_DV:
+      t --;
+      if (top == 0)
+	ps = PS_DIVIDE_BY_ZERO;
+      else top = stack[t] / top;
+      break;
+    case OP_NEG:
+      top = - top;
+      break;
+    case OP_CV:
+      stack[t] = top;
+      t ++;
+      break;
+    case OP_EQ:
+      t --;
+      top = (stack[t] == top);
+      break;
+    case OP_NE:
+      t --;
+      top = (stack[t] != top);
+      break;
+    case OP_GT:
+      t --;
+      top = (stack[t] > top);
+      break;
+    case OP_LT:
+      t --;
+      top = (stack[t] < top);
+      break;
+    case OP_GE:
+      t --;
+      top = (stack[t] >= top);
+      break;
+    case OP_LE:
+      t --;
+      top = (stack[t] <= top);
+      break;
+    case OP_BC:
+      if ((top < 0) || (top >= inst->q))
+	ps = PS_INDEX_OUT_OF_BOUNDS;
+      break;
+    case OP_FI:
+      address = stack[t-2];
+      if (checkAddress(address)) {
+	value = stack[t-1];
+	t --;
+	STORE(address, value);
+	if (LOAD(address) > top)
+	  pc = inst->q;
+      }
+      break;
+    case OP_FS:
+      address = stack[t-1];
+      if (checkAddress(address)) {
+	value = LOAD(address) + 1;
+	STORE(address, value);
+	if (value <= top)
+	  pc = inst->q;
+      }
+      break;
+    case OP_JEQ:
+      value = stack[t-1];
+      t -= 2;
+      if (value == top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_JNE:
+      value = stack[t-1];
+      t -= 2;
+      if (value != top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_JGT:
+      value = stack[t-1];
+      t -= 2;
+      if (value > top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_JLT:
+      value = stack[t-1];
+      t -= 2;
+      if (value < top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_JGE:
+      value = stack[t-1];
+      t -= 2;
+      if (value >= top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_JLE:
+      value = stack[t-1];
+      t -= 2;
+      if (value <= top)
+	pc = inst->q;
+      top = stack[t];
+      break;
+    case OP_BP:
+      break;
+    default:
+      ps = PS_ILLEGAL_INSTRUCTION;
+      break;
+    }
+  }
+  flushOutput();
+  programCounter = pc;
+  return ps;
+}
+
+// Address of the last executed instruction
+CodeAddress getProgramCounter(void) {
+  return programCounter - 1;
+}
+
+char* runtimeErrorMessage(int state) {
+  switch (state) {
+  case PS_DIVIDE_BY_ZERO: return "Divide by zero.";
+  case PS_STACK_OVERFLOW: return "Stack overflow.";
+  case PS_ILLEGAL_ADDRESS: return "Illegal address.";
+  case PS_ILLEGAL_INSTRUCTION: return "Illegal instruction.";
+  case PS_INDEX_OUT_OF_BOUNDS: return "Array index out of bounds.";
+  case PS_IO_ERROR: return "Input error.";
+  default: return "Unknown error.";
+  }
+}
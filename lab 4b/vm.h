@@ -0,0 +1,37 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include "instructions.h"
+
+#define DEFAULT_STACK_SIZE 1048576
+// 1 GB of words: with its guard area, no larger than itself, the stack
+// stays within a 32-bit size_t
+#define MAX_STACK_SIZE 268435456
+
+enum ProgramState {
+  PS_INACTIVE,
+  PS_ACTIVE,
+  PS_SUCCESS,
+  PS_DIVIDE_BY_ZERO,
+  PS_STACK_OVERFLOW,
+  PS_ILLEGAL_ADDRESS,
+  PS_ILLEGAL_INSTRUCTION,
+  PS_INDEX_OUT_OF_BOUNDS,
+  PS_IO_ERROR
+};
+
+int loadExecutable(char* fileName);
+int initVM(int size);
+void cleanVM(void);
+
+int run(void);
+CodeAddress getProgramCounter(void);
+char* runtimeErrorMessage(int state);
+
+#endif
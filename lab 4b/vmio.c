@@ -0,0 +1,113 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "vmio.h"
+
+// The standard input and output of a running program, read and written
+// a buffer at a time without stdio
+
+char inputBuffer[IO_BUFFER_SIZE];
+int inputStart = 0;
+int inputEnd = 0;
+
+char outputBuffer[IO_BUFFER_SIZE];
+int outputEnd = 0;
+
+void flushOutput(void) {
+  int start = 0;
+  int n;
+
+  while (start < outputEnd) {
+    n = write(STDOUT_FILENO, outputBuffer + start, outputEnd - start);
+    if (n <= 0) break;
+    start += n;
+  }
+  outputEnd = 0;
+}
+
+// The output is written before waiting for input, as a prompt may be there
+int fillInput(void) {
+  int n;
+
+  flushOutput();
+  n = read(STDIN_FILENO, inputBuffer, IO_BUFFER_SIZE);
+  inputStart = 0;
+  inputEnd = (n > 0) ? n : 0;
+  return inputEnd > 0;
+}
+
+int peekInput(void) {
+  if ((inputStart >= inputEnd) && !fillInput())
+    return EOF;
+  return (unsigned char) inputBuffer[inputStart];
+}
+
+int inputChar(void) {
+  int c = peekInput();
+
+  if (c != EOF) 
+    inputStart ++;
+  return c;
+}
+
+// As scanf("%d"): skip blanks, read an optional sign and the digits, and
+// leave the next character in the input
+int inputInt(int* value) {
+  unsigned int n = 0;
+  int negative = 0;
+  int c;
+
+  c = peekInput();
+  while ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == '\v') || (c == '\f')) {
+    inputStart ++;
+    c = peekInput();
+  }
+
+  if ((c == '-') || (c == '+')) {
+    negative = (c == '-');
+    inputStart ++;
+    c = peekInput();
+  }
+
+  if ((c < '0') || (c > '9'))
+    return 0;
+
+  while ((c >= '0') && (c <= '9')) {
+    n = n * 10 + (c - '0');
+    inputStart ++;
+    c = peekInput();
+  }
+
+  *value = negative ? (int) (0u - n) : (int) n;
+  return 1;
+}
+
+void outputChar(int c) {
+  if (outputEnd == IO_BUFFER_SIZE)
+    flushOutput();
+  outputBuffer[outputEnd ++] = (char) c;
+}
+
+void outputInt(int value) {
+  char digits[12];
+  unsigned int n = (value < 0) ? 0u - (unsigned int) value : (unsigned int) value;
+  int count = 0;
+
+  if (outputEnd > IO_BUFFER_SIZE - (int) sizeof(digits))
+    flushOutput();
+
+  do {
+    digits[count ++] = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+
+  if (value < 0)
+    outputBuffer[outputEnd ++] = '-';
+  while (count > 0) 
+    outputBuffer[outputEnd ++] = digits[-- count];
+}
@@ -0,0 +1,19 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VMIO_H__
+#define __VMIO_H__
+
+#define IO_BUFFER_SIZE 65536
+
+int inputChar(void);
+int inputInt(int* value);
+
+void outputChar(int c);
+void outputInt(int value);
+void flushOutput(void);
+
+#endif
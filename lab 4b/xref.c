@@ -0,0 +1,121 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "reader.h"
+#include "token.h"
+#include "xref.h"
+
+extern __thread SymTab* symtab;
+extern Token* currentToken;
+
+// kplc -xref: the definitions and uses are recorded while it is set,
+// not in the units compiled only for their declarations
+int indexing = 0;
+
+XrefRecord* xrefRecords = NULL;
+int xrefCount = 0;
+int maxXrefCount = 0;
+
+// At the name just read
+void addXrefRecord(Object* obj, Scope* scope, enum XrefUse use) {
+  XrefRecord* record;
+
+  if (xrefCount == maxXrefCount) {
+    maxXrefCount = (maxXrefCount == 0) ? 256 : 2 * maxXrefCount;
+    xrefRecords = (XrefRecord*) realloc(xrefRecords, maxXrefCount * sizeof(XrefRecord));
+  }
+  record = xrefRecords + xrefCount ++;
+  memset(record, 0, sizeof(XrefRecord));
+  strncpy(record->name, obj->name, MAX_IDENT_LEN);
+  if ((scope != NULL) && (scope->owner != NULL))
+    strncpy(record->scope, scope->owner->name, MAX_IDENT_LEN);
+  record->kind = obj->kind;
+  record->use = use;
+  record->lineNo = currentToken->lineNo;
+  record->colNo = currentToken->colNo;
+}
+
+// The object is declared in the current scope
+void indexDefinition(Object* obj) {
+  if (indexing)
+    addXrefRecord(obj, symtab->currentScope, XREF_DEFINITION);
+}
+
+// The object is found from the current scope
+void indexUse(Object* obj) {
+  Scope* scope;
+
+  if (!indexing) return;
+  switch (obj->kind) {
+  case OBJ_VARIABLE:
+    scope = obj->varAttrs->scope;
+    break;
+  case OBJ_PARAMETER:
+    scope = obj->paramAttrs->scope;
+    break;
+  case OBJ_FUNCTION:
+    scope = obj->funcAttrs->scope->outer;
+    break;
+  case OBJ_PROCEDURE:
+    scope = obj->procAttrs->scope->outer;
+    break;
+  default:
+    // Constants and types do not keep their scope
+    scope = symtab->currentScope;
+    while ((scope != NULL) && (findObject(scope->objList, obj->name) != obj))
+      scope = scope->outer;
+  }
+  addXrefRecord(obj, scope, XREF_USE);
+}
+
+int compareXrefRecords(const void* a, const void* b) {
+  const XrefRecord* record1 = (const XrefRecord*) a;
+  const XrefRecord* record2 = (const XrefRecord*) b;
+  int result = strcmp(record1->name, record2->name);
+
+  if (result != 0) return result;
+  if (record1->lineNo != record2->lineNo)
+    return record1->lineNo - record2->lineNo;
+  return record1->colNo - record2->colNo;
+}
+
+// The records sorted for kplx to search the mapped file, with the full
+// name of the source
+int saveIndex(char* fileName, char* sourceName) {
+  char path[PATH_MAX];
+  char name[MAX_SOURCE_NAME];
+  char* fullName;
+  XrefHeader header;
+  FILE* f;
+
+  f = fopen(fileName, "wb");
+  if (f == NULL) return IO_ERROR;
+
+  if (xrefCount > 0)
+    qsort(xrefRecords, xrefCount, sizeof(XrefRecord), compareXrefRecords);
+
+  header.magic = XREF_MAGIC;
+  header.sourceCount = 1;
+  header.recordCount = xrefCount;
+  memset(name, 0, MAX_SOURCE_NAME);
+  fullName = realpath(sourceName, path);
+  strncpy(name, (fullName == NULL) ? sourceName : fullName, MAX_SOURCE_NAME - 1);
+
+  fwrite(&header, sizeof(XrefHeader), 1, f);
+  fwrite(name, MAX_SOURCE_NAME, 1, f);
+  fwrite(xrefRecords, sizeof(XrefRecord), xrefCount, f);
+  fclose(f);
+
+  free(xrefRecords);
+  xrefRecords = NULL;
+  xrefCount = maxXrefCount = 0;
+  return IO_SUCCESS;
+}
@@ -0,0 +1,51 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __XREF_H__
+#define __XREF_H__
+
+#include "symtab.h"
+
+// "KPLX" at the start of an index file
+#define XREF_MAGIC 0x584C504B
+#define MAX_SOURCE_NAME 256
+
+enum XrefUse {
+  XREF_DEFINITION,
+  XREF_USE
+};
+
+// A definition or a use of an object. The scope is the subprogram, program
+// or unit declaring the object, empty for the predefined and imported ones.
+struct XrefRecord_ {
+  char name[MAX_IDENT_LEN + 1];
+  char scope[MAX_IDENT_LEN + 1];
+  int source;   // in the names of the sources of the index
+  int kind;     // enum ObjectKind
+  int use;      // enum XrefUse
+  int lineNo, colNo;
+};
+
+typedef struct XrefRecord_ XrefRecord;
+
+// The full names of the sources follow, in MAX_SOURCE_NAME chars each, 
+// then the records sorted by name, then by source and place. kplc saves 
+// the index of a source, kplx merge the index of a tree.
+struct XrefHeader_ {
+  int magic;
+  int sourceCount;
+  int recordCount;
+};
+
+typedef struct XrefHeader_ XrefHeader;
+
+extern int indexing;
+
+void indexDefinition(Object* obj);
+void indexUse(Object* obj);
+int saveIndex(char* fileName, char* sourceName);
+
+#endif